@@ -7,6 +7,31 @@
 
 bool receivedSigInt = false;
 
+std::vector<ndn::Name> AbstractProgram::positionTopics() const {
+    std::vector<std::string> platoons;
+    auto p = m_participantPrefix.get(1).toUri();
+    platoons.push_back(p);
+    if (p == "platoon0") {
+        platoons.push_back("platoon3");
+        platoons.push_back("platoon1");
+    } else if (p == "platoon1") {
+        platoons.push_back("platoon0");
+        platoons.push_back("platoon2");
+    } else if (p == "platoon2") {
+        platoons.push_back("platoon1");
+        platoons.push_back("platoon3");
+    } else if (p == "platoon3") {
+        platoons.push_back("platoon2");
+        platoons.push_back("platoon0");
+    }
+
+    std::vector<ndn::Name> topics;
+    for (const auto &platoon : platoons) {
+        topics.emplace_back("/position/ndn/" + platoon);
+    }
+    return topics;
+}
+
 void AbstractProgram::fetchOutStandingVoiceSegements(ndn::Name name, int finalBlockId) {
     ndn::Name withoutSegmentNo = name.getPrefix(name.size() - 1);
 
@@ -129,6 +129,14 @@ protected:
      */
     void fetchOutStandingVoiceSegements(ndn::Name name, int finalBlockId);
 
+    /**
+     * Position topics this participant subscribes to: its own platoon and the two neighbouring ones
+     * (the platoons are arranged in a ring platoon0 ... platoon3).
+     *
+     * @return one /position/ndn/<platoon> prefix per platoon
+     */
+    std::vector<ndn::Name> positionTopics() const;
+
     /**
      * Thread loop that publishes position Data
      */
@@ -0,0 +1,187 @@
+/*
+ * Vectorized kernels for the structure-of-arrays IBLT layout (see iblt.h).
+ *
+ * Each kernel has a portable scalar version and, when the compiler targets
+ * it, an SSE2 or AVX2 version. The un-suffixed entry points pick the widest
+ * available implementation at compile time; the scalar ones stay visible so
+ * they can be benchmarked against each other.
+ */
+
+#ifndef SYNCPS_IBLT_SIMD_HPP
+#define SYNCPS_IBLT_SIMD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace syncps {
+namespace simd {
+
+    /**
+     * @brief a[i] -= b[i] for i in [0, n)
+     */
+    static inline void subScalar(int32_t* a, const int32_t* b, size_t n)
+    {
+        for (size_t i = 0; i < n; i++) {
+            a[i] -= b[i];
+        }
+    }
+
+    /**
+     * @brief a[i] ^= b[i] for i in [0, n)
+     */
+    static inline void xorScalar(uint32_t* a, const uint32_t* b, size_t n)
+    {
+        for (size_t i = 0; i < n; i++) {
+            a[i] ^= b[i];
+        }
+    }
+
+    /**
+     * @brief append to 'out' the index of every cell whose count is +1 or -1
+     *        (the only cells that can be 'pure'). Indices are offset by 'base'.
+     */
+    static inline void findUnitCountsScalar(const int32_t* count, size_t n,
+                                            std::vector<uint32_t>& out, size_t base = 0)
+    {
+        for (size_t i = 0; i < n; i++) {
+            if (count[i] == 1 || count[i] == -1) {
+                out.push_back(base + i);
+            }
+        }
+    }
+
+#if defined(__AVX2__)
+    static constexpr size_t LANES = 8;
+
+    static inline void subVector(int32_t* a, const int32_t* b, size_t n)
+    {
+        size_t i = 0;
+        for (; i + LANES <= n; i += LANES) {
+            auto va = _mm256_loadu_si256((const __m256i*)(a + i));
+            auto vb = _mm256_loadu_si256((const __m256i*)(b + i));
+            _mm256_storeu_si256((__m256i*)(a + i), _mm256_sub_epi32(va, vb));
+        }
+        subScalar(a + i, b + i, n - i);
+    }
+
+    static inline void xorVector(uint32_t* a, const uint32_t* b, size_t n)
+    {
+        size_t i = 0;
+        for (; i + LANES <= n; i += LANES) {
+            auto va = _mm256_loadu_si256((const __m256i*)(a + i));
+            auto vb = _mm256_loadu_si256((const __m256i*)(b + i));
+            _mm256_storeu_si256((__m256i*)(a + i), _mm256_xor_si256(va, vb));
+        }
+        xorScalar(a + i, b + i, n - i);
+    }
+
+    static inline void findUnitCountsVector(const int32_t* count, size_t n,
+                                            std::vector<uint32_t>& out)
+    {
+        // count == ±1  <=>  (count + 1) is 0 or 2  <=>  ((count + 1) & ~2) == 0
+        const auto one = _mm256_set1_epi32(1);
+        const auto notTwo = _mm256_set1_epi32(~2);
+        const auto zero = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + LANES <= n; i += LANES) {
+            auto v = _mm256_loadu_si256((const __m256i*)(count + i));
+            v = _mm256_and_si256(_mm256_add_epi32(v, one), notTwo);
+            auto mask = (uint32_t)_mm256_movemask_ps(
+                    _mm256_castsi256_ps(_mm256_cmpeq_epi32(v, zero)));
+            while (mask != 0) {
+                out.push_back(i + __builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+        findUnitCountsScalar(count + i, n - i, out, i);
+    }
+#elif defined(__SSE2__)
+    static constexpr size_t LANES = 4;
+
+    static inline void subVector(int32_t* a, const int32_t* b, size_t n)
+    {
+        size_t i = 0;
+        for (; i + LANES <= n; i += LANES) {
+            auto va = _mm_loadu_si128((const __m128i*)(a + i));
+            auto vb = _mm_loadu_si128((const __m128i*)(b + i));
+            _mm_storeu_si128((__m128i*)(a + i), _mm_sub_epi32(va, vb));
+        }
+        subScalar(a + i, b + i, n - i);
+    }
+
+    static inline void xorVector(uint32_t* a, const uint32_t* b, size_t n)
+    {
+        size_t i = 0;
+        for (; i + LANES <= n; i += LANES) {
+            auto va = _mm_loadu_si128((const __m128i*)(a + i));
+            auto vb = _mm_loadu_si128((const __m128i*)(b + i));
+            _mm_storeu_si128((__m128i*)(a + i), _mm_xor_si128(va, vb));
+        }
+        xorScalar(a + i, b + i, n - i);
+    }
+
+    static inline void findUnitCountsVector(const int32_t* count, size_t n,
+                                            std::vector<uint32_t>& out)
+    {
+        // count == ±1  <=>  (count + 1) is 0 or 2  <=>  ((count + 1) & ~2) == 0
+        const auto one = _mm_set1_epi32(1);
+        const auto notTwo = _mm_set1_epi32(~2);
+        const auto zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + LANES <= n; i += LANES) {
+            auto v = _mm_loadu_si128((const __m128i*)(count + i));
+            v = _mm_and_si128(_mm_add_epi32(v, one), notTwo);
+            auto mask = (uint32_t)_mm_movemask_ps(
+                    _mm_castsi128_ps(_mm_cmpeq_epi32(v, zero)));
+            while (mask != 0) {
+                out.push_back(i + __builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+        findUnitCountsScalar(count + i, n - i, out, i);
+    }
+#else
+    static constexpr size_t LANES = 1;
+
+    static inline void subVector(int32_t* a, const int32_t* b, size_t n)
+    {
+        subScalar(a, b, n);
+    }
+
+    static inline void xorVector(uint32_t* a, const uint32_t* b, size_t n)
+    {
+        xorScalar(a, b, n);
+    }
+
+    static inline void findUnitCountsVector(const int32_t* count, size_t n,
+                                            std::vector<uint32_t>& out)
+    {
+        findUnitCountsScalar(count, n, out);
+    }
+#endif
+
+    static inline void sub(int32_t* a, const int32_t* b, size_t n)
+    {
+        subVector(a, b, n);
+    }
+
+    static inline void xorInto(uint32_t* a, const uint32_t* b, size_t n)
+    {
+        xorVector(a, b, n);
+    }
+
+    static inline void findUnitCounts(const int32_t* count, size_t n,
+                                      std::vector<uint32_t>& out)
+    {
+        findUnitCountsVector(count, n, out);
+    }
+
+}  // namespace simd
+}  // namespace syncps
+
+#endif  // SYNCPS_IBLT_SIMD_HPP
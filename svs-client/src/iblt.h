@@ -47,7 +47,9 @@
 #ifndef SYNCPS_IBLT_HPP
 #define SYNCPS_IBLT_HPP
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <inttypes.h>
 #include <iomanip>
 #include <iostream>
@@ -58,16 +60,21 @@
 
 #include <boost/iostreams/copy.hpp>
 #include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <ndn-cxx/name.hpp>
 
+#include "iblt-simd.h"
+
 namespace syncps {
 
     namespace bio = boost::iostreams;
 
     static constexpr size_t N_HASH(3);
     static constexpr size_t N_HASHCHECK(11);
+    // largest table IBLT::decode will build from a peer's encoding
+    static constexpr size_t MAX_CELLS(1 << 16);
 
 /*
  * murmurHash3 was written by Austin Appleby, and is placed in the public
@@ -81,16 +88,18 @@ namespace syncps {
     }
 
     static inline uint32_t murmurHash3(uint32_t nHashSeed,
-                                       const std::vector<unsigned char>& vDataToHash)
+                                       const uint8_t* dataToHash, size_t len)
     {
         uint32_t h1 = nHashSeed;
         const uint32_t c1 = 0xcc9e2d51;
         const uint32_t c2 = 0x1b873593;
-        const size_t nblocks = vDataToHash.size() / 4;
-        const uint32_t* blocks = (const uint32_t*)(&vDataToHash[0] + nblocks * 4);
+        const size_t nblocks = len / 4;
+        const uint8_t* blocks = dataToHash + nblocks * 4;
 
         for (size_t i = -nblocks; i; i++) {
-            uint32_t k1 = blocks[i];
+            // blocks may be unaligned (e.g., inside a wire encoding)
+            uint32_t k1;
+            std::memcpy(&k1, blocks + i * 4, sizeof(k1));
 
             k1 *= c1;
             k1 = ROTL32(k1, 15);
@@ -101,9 +110,9 @@ namespace syncps {
             h1 = h1 * 5 + 0xe6546b64;
         }
 
-        const uint8_t* tail = (const uint8_t*)(&vDataToHash[0] + nblocks * 4);
+        const uint8_t* tail = dataToHash + nblocks * 4;
         uint32_t k1 = 0;
-        switch (vDataToHash.size() & 3) {
+        switch (len & 3) {
             case 3:
                 k1 ^= tail[2] << 16;
                         NDN_CXX_FALLTHROUGH;
@@ -117,7 +126,7 @@ namespace syncps {
                 k1 *= c2;
                 h1 ^= k1;
         }
-        h1 ^= vDataToHash.size();
+        h1 ^= len;
         h1 ^= h1 >> 16;
         h1 *= 0x85ebca6b;
         h1 ^= h1 >> 13;
@@ -126,17 +135,42 @@ namespace syncps {
         return h1;
     }
 
+    static inline uint32_t murmurHash3(uint32_t nHashSeed,
+                                       const std::vector<unsigned char>& vDataToHash)
+    {
+        return murmurHash3(nHashSeed, vDataToHash.data(), vDataToHash.size());
+    }
+
     static inline uint32_t murmurHash3(uint32_t nHashSeed, const std::string& str)
     {
-        return murmurHash3(nHashSeed,
-                           std::vector<unsigned char>(str.begin(), str.end()));
+        return murmurHash3(nHashSeed, (const uint8_t*)str.data(), str.size());
     }
 
+    /**
+     * Fixed-width fast path for the (very frequent) case of hashing one
+     * 32 bit IBLT key: a single block and no tail. Gives the same result
+     * as hashing the 4 bytes of 'value' in memory order.
+     */
     static inline uint32_t murmurHash3(uint32_t nHashSeed, uint32_t value)
     {
-        return murmurHash3(nHashSeed,
-                           std::vector<unsigned char>((unsigned char*)&value,
-                                                      (unsigned char*)&value + sizeof(uint32_t)));
+        uint32_t h1 = nHashSeed;
+        uint32_t k1 = value;
+
+        k1 *= 0xcc9e2d51;
+        k1 = ROTL32(k1, 15);
+        k1 *= 0x1b873593;
+
+        h1 ^= k1;
+        h1 = ROTL32(h1, 13);
+        h1 = h1 * 5 + 0xe6546b64;
+
+        h1 ^= sizeof(uint32_t);
+        h1 ^= h1 >> 16;
+        h1 *= 0x85ebca6b;
+        h1 ^= h1 >> 13;
+        h1 *= 0xc2b2ae35;
+        h1 ^= h1 >> 16;
+        return h1;
     }
 
     class HashTableEntry
@@ -160,6 +194,56 @@ namespace syncps {
         }
     };
 
+    /**
+     * @brief Caller-owned buffers for the result of peeling an IBLT
+     *
+     * Kept across calls so that decoding a difference doesn't allocate
+     * once the vectors have grown to their working size.
+     */
+    struct PeelBuffers
+    {
+        std::vector<uint32_t> positive;  // keys with count +1
+        std::vector<uint32_t> negative;  // keys with count -1
+        std::vector<uint32_t> worklist;  // scratch: cells that may be pure
+        bool complete{false};            // every entry was peeled
+        // scratch: the table IBLT::listEntries peels (a copy of its cells)
+        std::vector<int32_t> count;
+        std::vector<uint32_t> keySum;
+        std::vector<uint32_t> keyCheck;
+
+        void clear() noexcept
+        {
+            positive.clear();
+            negative.clear();
+            worklist.clear();
+            complete = false;
+        }
+    };
+
+    /**
+     * @brief Wire encodings of an IBLT name component
+     *
+     * Legacy is the original PSync format: a zlib stream of 12 bytes per
+     * cell, with no version byte (a zlib stream always starts with 0x78).
+     * The compact encodings start with a version byte followed by
+     * varint(#cells) and only the non-empty cells, each as
+     *   header [varint(gap - 31)] [varint(zigzag(count) - 7)] keySum keyCheck
+     * where gap is the number of empty cells skipped, the header byte holds
+     * min(gap, 31) in its top 5 bits and min(zigzag(count), 7) in its low
+     * 3 bits, and the sums are 4 byte little endian. So a typical cell
+     * costs 9 bytes and an empty one nothing. CompactZlib additionally runs
+     * everything after the version byte through zlib.
+     *
+     * Only Legacy can be decoded by peers running the original code so it
+     * is the default.
+     */
+    enum class IBLTEncoding
+    {
+        Legacy,
+        Compact,
+        CompactZlib
+    };
+
     class IBLT;
     static inline std::ostream& operator<<(std::ostream& out, const IBLT& iblt);
     static inline std::ostream& operator<<(std::ostream& out, const HashTableEntry& hte);
@@ -168,6 +252,11 @@ namespace syncps {
  * @brief Invertible Bloom Lookup Table (Invertible Bloom Filter)
  *
  * Used by Partial Sync (PartialProducer) and Full Sync (Full Producer)
+ *
+ * The table is stored as a structure of arrays (one array each for count,
+ * keySum and keyCheck) so whole-table operations (subtraction, finding
+ * peel candidates) can use the vector kernels in iblt-simd.h.
+ * HashTableEntry is only used to hand out a copy of a single cell.
  */
     class IBLT
     {
@@ -175,6 +264,10 @@ namespace syncps {
         static constexpr int INSERT = 1;
         static constexpr int ERASE = -1;
 
+        // version bytes of the compact encodings (see IBLTEncoding)
+        static constexpr uint8_t COMPACT = 0x01;
+        static constexpr uint8_t COMPACT_ZLIB = 0x02;
+
     public:
         class Error : public std::runtime_error
         {
@@ -196,34 +289,132 @@ namespace syncps {
             if (remainder != 0) {
                 nEntries += (N_HASH - remainder);
             }
-            m_hashTable.resize(nEntries);
+            resize(nEntries);
         }
 
-        IBLT(const std::vector<HashTableEntry>& hashTable) : m_hashTable(hashTable) {}
+        IBLT(const std::vector<HashTableEntry>& hashTable)
+        {
+            resize(hashTable.size());
+            for (size_t i = 0; i < hashTable.size(); i++) {
+                m_count[i] = hashTable[i].count;
+                m_keySum[i] = hashTable[i].keySum;
+                m_keyCheck[i] = hashTable[i].keyCheck;
+            }
+        }
+
+        /**
+         * @brief number of cells in the table
+         */
+        size_t size() const noexcept { return m_count.size(); }
+
+        /**
+         * @brief a copy of cell 'idx'
+         */
+        HashTableEntry cell(size_t idx) const
+        {
+            return {m_count.at(idx), m_keySum.at(idx), m_keyCheck.at(idx)};
+        }
 
         /**
          * @brief Populate the hash table using the vector representation of IBLT
          *
+         * The encoding is recognized from the first byte of the component
+         * so peers using any IBLTEncoding can be decoded.
+         *
          * @param ibltName the Component representation of IBLT
          * @throws Error if size of values is not compatible with this IBF
          */
         void initialize(const ndn::name::Component& ibltName)
         {
+            load(ibltName, false);
+        }
+
+        /**
+         * @brief Populate the hash table from a Component, taking its size
+         *        from the encoding (as opposed to initialize, which
+         *        requires it to match this table's size).
+         *
+         * @param ibltName the Component representation of IBLT
+         * @throws Error if the encoding is invalid or has more than MAX_CELLS
+         */
+        void decode(const ndn::name::Component& ibltName)
+        {
+            load(ibltName, true);
+        }
+
+        /**
+         * @brief estimate how many entries the table holds from the
+         *        fraction of its cells that are empty.
+         *
+         * A key lands in one cell of each of the N_HASH subtables of m cells
+         * so after d keys a cell is empty with probability (1 - 1/m)^d.
+         * This works when the table is too full to peel, which makes it a
+         * difference-size estimate for (ownIBLT - rcvdIBLT).
+         *
+         * @return the estimate (N_HASH * size() if no cell is empty)
+         */
+        size_t estimateEntries() const
+        {
+            size_t empty = 0;
+            for (size_t i = 0; i < size(); i++) {
+                empty += (m_count[i] == 0 && m_keySum[i] == 0 && m_keyCheck[i] == 0);
+            }
+            double m = double(size() / N_HASH);
+            if (empty == size()) {
+                return 0;
+            }
+            if (empty == 0 || m < 2) {
+                return N_HASH * size();
+            }
+            return size_t(std::log(double(empty) / size()) / std::log(1 - 1 / m) + 0.5);
+        }
+
+    private:
+        void load(const ndn::name::Component& ibltName, bool adoptSize)
+        {
+            const uint8_t* value = ibltName.value();
+            size_t len = ibltName.value_size();
+            if (len > 0 && value[0] == COMPACT) {
+                decodeCompact(value + 1, value + len, adoptSize);
+                return;
+            }
+            if (len > 0 && value[0] == COMPACT_ZLIB) {
+                const auto raw = inflate(value + 1, len - 1, MAX_COMPACT_SIZE);
+                decodeCompact((const uint8_t*)raw.data(), (const uint8_t*)raw.data() + raw.size(),
+                              adoptSize);
+                return;
+            }
             const auto& values = extractValueFromName(ibltName);
 
-            if (3 * m_hashTable.size() != values.size()) {
+            if (adoptSize && values.size() % 3 == 0) {
+                adopt(values.size() / 3);
+            }
+            if (3 * size() != values.size()) {
                 BOOST_THROW_EXCEPTION(Error("Received IBF cannot be decoded!"));
             }
-            for (size_t i = 0; i < m_hashTable.size(); i++) {
-                HashTableEntry& entry = m_hashTable.at(i);
-                if (values[i * 3] != 0) {
-                    entry.count = values[i * 3];
-                    entry.keySum = values[(i * 3) + 1];
-                    entry.keyCheck = values[(i * 3) + 2];
-                }
+            // every cell is restored, including ones with a zero count but
+            // non-zero sums (which a difference can have)
+            for (size_t i = 0; i < size(); i++) {
+                m_count[i] = values[i * 3];
+                m_keySum[i] = values[(i * 3) + 1];
+                m_keyCheck[i] = values[(i * 3) + 2];
             }
         }
 
+        /**
+         * @brief resize to a peer's 'nCells' (throws if it isn't a usable size)
+         */
+        void adopt(size_t nCells)
+        {
+            if (nCells == 0 || nCells % N_HASH != 0 || nCells > MAX_CELLS) {
+                BOOST_THROW_EXCEPTION(Error("Received IBF cannot be decoded!"));
+            }
+            m_count.assign(nCells, 0);
+            m_keySum.assign(nCells, 0);
+            m_keyCheck.assign(nCells, 0);
+        }
+
+    public:
         /**
          * Entry Hash functions. The hash table is split into N_HASH
          * equal-sized sub-tables with a different hash function for each.
@@ -231,17 +422,17 @@ namespace syncps {
          */
         auto hash0(size_t key) const noexcept
         {
-            auto stsize = m_hashTable.size() / N_HASH;
+            auto stsize = size() / N_HASH;
             return murmurHash3(0, key) % stsize;
         }
         auto hash1(size_t key) const noexcept
         {
-            auto stsize = m_hashTable.size() / N_HASH;
+            auto stsize = size() / N_HASH;
             return murmurHash3(1, key) % stsize + stsize;
         }
         auto hash2(size_t key) const noexcept
         {
-            auto stsize = m_hashTable.size() / N_HASH;
+            auto stsize = size() / N_HASH;
             return murmurHash3(2, key) % stsize + stsize * 2;
         }
 
@@ -256,7 +447,7 @@ namespace syncps {
          */
         bool chkPeer(size_t key, size_t idx) const noexcept
         {
-            auto hte = getHashTable().at(idx);
+            auto hte = cell(idx);
             return hte.isEmpty() || (hte.isPure() && hte.keySum != key);
         }
 
@@ -266,7 +457,17 @@ namespace syncps {
                    chkPeer(key, hash2(key));
         }
 
-        void insert(uint32_t key) { update(INSERT, key); }
+        bool badPeers(size_t key, const size_t (&idx)[N_HASH]) const noexcept
+        {
+            return chkPeer(key, idx[0]) || chkPeer(key, idx[1]) ||
+                   chkPeer(key, idx[2]);
+        }
+
+        void insert(uint32_t key)
+        {
+            update(INSERT, key);
+            ++m_version;
+        }
 
         void erase(uint32_t key)
         {
@@ -276,8 +477,29 @@ namespace syncps {
                 return;
             }
             update(ERASE, key);
+            ++m_version;
+        }
+
+        /**
+         * @brief add (+1) or remove (-1) 'key' without validity checks
+         *
+         * Meant for keeping a difference (ownIBLT - rcvdIBLT) current as
+         * ownIBLT changes; erase's checks don't hold for a difference.
+         */
+        void apply(int plusOrMinus, uint32_t key)
+        {
+            update(plusOrMinus, key);
+            ++m_version;
         }
 
+        /**
+         * @brief number of inserts and erases applied to this table
+         *
+         * Lets users cache things derived from the table's contents (e.g.,
+         * its encoding) until the next change.
+         */
+        uint64_t version() const noexcept { return m_version; }
+
         /**
          * @brief List all the entries in the IBLT
          *
@@ -292,63 +514,124 @@ namespace syncps {
         bool listEntries(std::set<uint32_t>& positive,
                          std::set<uint32_t>& negative) const
         {
-            IBLT peeled = *this;
-
-            bool peeledSomething;
-            do {
-                peeledSomething = false;
-                for (const auto& entry : peeled.m_hashTable) {
-                    if (entry.isPure()) {
-                        if (peeled.badPeers(entry.keySum)) {
-                            std::cerr << "error - invalid iblt: badPeers for entry:"
-                                      << entry << "\n";
-                            return false;
-                        }
-                        if (entry.count == 1) {
-                            positive.insert(entry.keySum);
-                        } else {
-                            negative.insert(entry.keySum);
-                        }
-                        peeled.update(-entry.count, entry.keySum);
-                        peeledSomething = true;
-                    }
-                }
-            } while (peeledSomething);
+            PeelBuffers peeled;
+            bool ok = listEntries(peeled);
+            positive.insert(peeled.positive.begin(), peeled.positive.end());
+            negative.insert(peeled.negative.begin(), peeled.negative.end());
+            return ok;
+        }
 
+        /**
+         * @brief List all the entries in the IBLT, leaving it unchanged
+         *
+         * The table is copied into out's scratch cells and peeled there, so
+         * once those have grown to the table's size nothing is allocated.
+         *
+         * @param out cleared, then filled with the positive/negative keys
+         * @return true if decoding is complete successfully
+         */
+        bool listEntries(PeelBuffers& out) const
+        {
+            out.count.assign(m_count.begin(), m_count.end());
+            out.keySum.assign(m_keySum.begin(), m_keySum.end());
+            out.keyCheck.assign(m_keyCheck.begin(), m_keyCheck.end());
+            return peelCells(out.count.data(), out.keySum.data(), out.keyCheck.data(), out);
+        }
+
+        /**
+         * @brief Peel this IBLT in place, listing its entries in 'out'
+         *
+         * Same result as listEntries but destroys the table, so it is
+         * meant for temporaries like (ownIBLT - rcvdIBLT).
+         *
+         * @param out cleared, then filled with the positive/negative keys
+         * @return true if decoding is complete successfully
+         */
+        bool peel(PeelBuffers& out)
+        {
+            return peelCells(m_count.data(), m_keySum.data(), m_keyCheck.data(), out);
+        }
+
+        /**
+         * @brief true if every cell is empty
+         */
+        bool isEmpty() const noexcept
+        {
+            for (size_t i = 0; i < size(); i++) {
+                if (m_count[i] != 0 || m_keySum[i] != 0 || m_keyCheck[i] != 0) {
+                    return false;
+                }
+            }
             return true;
         }
 
         IBLT operator-(const IBLT& other) const
         {
-            BOOST_ASSERT(m_hashTable.size() == other.m_hashTable.size());
+            if (size() != other.size()) {
+                BOOST_THROW_EXCEPTION(Error("IBF sizes differ"));
+            }
 
             IBLT result(*this);
-            for (size_t i = 0; i < m_hashTable.size(); i++) {
-                HashTableEntry& e1 = result.m_hashTable.at(i);
-                const HashTableEntry& e2 = other.m_hashTable.at(i);
-                e1.count -= e2.count;
-                e1.keySum ^= e2.keySum;
-                e1.keyCheck ^= e2.keyCheck;
-            }
+            simd::sub(result.m_count.data(), other.m_count.data(), size());
+            simd::xorInto(result.m_keySum.data(), other.m_keySum.data(), size());
+            simd::xorInto(result.m_keyCheck.data(), other.m_keyCheck.data(), size());
             return result;
         }
 
-        std::vector<HashTableEntry> getHashTable() const { return m_hashTable; }
+        std::vector<HashTableEntry> getHashTable() const
+        {
+            std::vector<HashTableEntry> table(size());
+            for (size_t i = 0; i < size(); i++) {
+                table[i] = cell(i);
+            }
+            return table;
+        }
+
+        bool operator==(const IBLT& other) const
+        {
+            return m_count == other.m_count && m_keySum == other.m_keySum &&
+                   m_keyCheck == other.m_keyCheck;
+        }
 
         /**
          * @brief Appends self to name
          *
+         * @param name
+         * @param encoding wire format of the appended component
+         */
+        void appendToName(ndn::Name& name,
+                          IBLTEncoding encoding = IBLTEncoding::Legacy) const
+        {
+            name.append(toComponent(encoding));
+        }
+
+        /**
+         * @brief Encode self as a name component
+         */
+        ndn::name::Component toComponent(IBLTEncoding encoding = IBLTEncoding::Legacy) const
+        {
+            switch (encoding) {
+                case IBLTEncoding::Legacy:
+                    return encodeLegacy();
+                case IBLTEncoding::CompactZlib:
+                    return encodeCompact(true);
+                default:
+                    return encodeCompact(false);
+            }
+        }
+
+        /**
+         * @brief Encodes self in the Legacy format
+         *
          * Encodes our hash table from uint32_t vector to uint8_t vector
          * We create a uin8_t vector 12 times the size of uint32_t vector
          * We put the first count in first 4 cells, keySum in next 4, and keyCheck
          * in next 4. Repeat for all the other cells of the hash table. Then we
-         * append this uint8_t vector to the name.
-         *
-         * @param name
+         * zlib compress this uint8_t vector.
          */
-        void appendToName(ndn::Name& name) const
+        ndn::name::Component encodeLegacy() const
         {
-            size_t n = m_hashTable.size();
+            size_t n = size();
             size_t unitSize = (32 * 3) / 8;  // hard coding
             size_t tableSize = unitSize * n;
 
@@ -358,26 +641,26 @@ namespace syncps {
                 // table[i*12],   table[i*12+1], table[i*12+2], table[i*12+3] -->
                 // hashTable[i].count
 
-                table[(i * unitSize)] = 0xFF & m_hashTable[i].count;
-                table[(i * unitSize) + 1] = 0xFF & (m_hashTable[i].count >> 8);
-                table[(i * unitSize) + 2] = 0xFF & (m_hashTable[i].count >> 16);
-                table[(i * unitSize) + 3] = 0xFF & (m_hashTable[i].count >> 24);
+                table[(i * unitSize)] = 0xFF & m_count[i];
+                table[(i * unitSize) + 1] = 0xFF & (m_count[i] >> 8);
+                table[(i * unitSize) + 2] = 0xFF & (m_count[i] >> 16);
+                table[(i * unitSize) + 3] = 0xFF & (m_count[i] >> 24);
 
                 // table[i*12+4], table[i*12+5], table[i*12+6], table[i*12+7] -->
                 // hashTable[i].keySum
 
-                table[(i * unitSize) + 4] = 0xFF & m_hashTable[i].keySum;
-                table[(i * unitSize) + 5] = 0xFF & (m_hashTable[i].keySum >> 8);
-                table[(i * unitSize) + 6] = 0xFF & (m_hashTable[i].keySum >> 16);
-                table[(i * unitSize) + 7] = 0xFF & (m_hashTable[i].keySum >> 24);
+                table[(i * unitSize) + 4] = 0xFF & m_keySum[i];
+                table[(i * unitSize) + 5] = 0xFF & (m_keySum[i] >> 8);
+                table[(i * unitSize) + 6] = 0xFF & (m_keySum[i] >> 16);
+                table[(i * unitSize) + 7] = 0xFF & (m_keySum[i] >> 24);
 
                 // table[i*12+8], table[i*12+9], table[i*12+10], table[i*12+11] -->
                 // hashTable[i].keyCheck
 
-                table[(i * unitSize) + 8] = 0xFF & m_hashTable[i].keyCheck;
-                table[(i * unitSize) + 9] = 0xFF & (m_hashTable[i].keyCheck >> 8);
-                table[(i * unitSize) + 10] = 0xFF & (m_hashTable[i].keyCheck >> 16);
-                table[(i * unitSize) + 11] = 0xFF & (m_hashTable[i].keyCheck >> 24);
+                table[(i * unitSize) + 8] = 0xFF & m_keyCheck[i];
+                table[(i * unitSize) + 9] = 0xFF & (m_keyCheck[i] >> 8);
+                table[(i * unitSize) + 10] = 0xFF & (m_keyCheck[i] >> 16);
+                table[(i * unitSize) + 11] = 0xFF & (m_keyCheck[i] >> 24);
             }
             bio::filtering_streambuf<bio::input> in;
             in.push(bio::zlib_compressor());
@@ -387,7 +670,53 @@ namespace syncps {
             bio::copy(in, sstream);
 
             std::string compressedIBF = sstream.str();
-            name.append((const uint8_t *)compressedIBF.data(), compressedIBF.size());
+            return ndn::name::Component((const uint8_t *)compressedIBF.data(), compressedIBF.size());
+        }
+
+        /**
+         * @brief Encodes self in the Compact or CompactZlib format
+         *
+         * The uncompressed form is written straight into the buffer that
+         * becomes the component's value.
+         */
+        ndn::name::Component encodeCompact(bool zlib) const
+        {
+            // worst case per cell: header + 5 byte gap + 5 byte count + 8 bytes of sums
+            auto buf = std::make_shared<ndn::Buffer>(1 + 5 + size() * 19);
+            uint8_t* p = buf->data();
+            *p++ = COMPACT;
+            p = putVarint(p, size());
+            size_t next = 0;  // index of the cell after the last one written
+            for (size_t i = 0; i < size(); i++) {
+                if (m_count[i] == 0 && m_keySum[i] == 0 && m_keyCheck[i] == 0) {
+                    continue;
+                }
+                uint32_t gap = i - next;
+                uint32_t zz = ((uint32_t)m_count[i] << 1) ^ (uint32_t)(m_count[i] >> 31);
+                *p++ = (std::min<uint32_t>(gap, 31) << 3) | std::min<uint32_t>(zz, 7);
+                if (gap >= 31) {
+                    p = putVarint(p, gap - 31);
+                }
+                if (zz >= 7) {
+                    p = putVarint(p, zz - 7);
+                }
+                p = putLE32(p, m_keySum[i]);
+                p = putLE32(p, m_keyCheck[i]);
+                next = i + 1;
+            }
+            buf->resize(p - buf->data());
+            if (!zlib) {
+                return ndn::name::Component(std::move(buf));
+            }
+
+            std::vector<char> compressed;
+            compressed.reserve(buf->size());
+            compressed.push_back(COMPACT_ZLIB);
+            bio::filtering_streambuf<bio::input> in;
+            in.push(bio::zlib_compressor());
+            in.push(bio::array_source((const char*)buf->data() + 1, buf->size() - 1));
+            bio::copy(in, bio::back_inserter(compressed));
+            return ndn::name::Component((const uint8_t*)compressed.data(), compressed.size());
         }
 
         /**
@@ -402,15 +731,8 @@ namespace syncps {
         std::vector<uint32_t> extractValueFromName(
                 const ndn::name::Component& ibltName) const
         {
-            std::string compressed(ibltName.value_begin(), ibltName.value_end());
-
-            bio::filtering_streambuf<bio::input> in;
-            in.push(bio::zlib_decompressor());
-            in.push(bio::array_source(compressed.data(), compressed.size()));
-
-            std::stringstream sstream;
-            bio::copy(in, sstream);
-            std::string ibltStr = sstream.str();
+            const auto ibltStr = inflate(ibltName.value(), ibltName.value_size(),
+                                         std::max(size(), MAX_CELLS) * 12);
 
             std::vector<uint8_t> ibltValues(ibltStr.begin(), ibltStr.end());
             size_t n = ibltValues.size() / 4;
@@ -426,48 +748,249 @@ namespace syncps {
         }
 
     private:
-        void update(int plusOrMinus, uint32_t key)
+        // longest compact encoding of a MAX_CELLS table after the version
+        // byte: varint(#cells) then at most 19 bytes a cell (see encodeCompact)
+        static constexpr size_t MAX_COMPACT_SIZE = 5 + MAX_CELLS * 19;
+
+        /**
+         * @brief zlib-inflate the 'len' bytes at 'p' (from a peer)
+         *
+         * @throws Error if they inflate to more than 'limit' bytes, which
+         *         is checked as it goes so a small component can't make
+         *         us inflate a huge one
+         */
+        static std::vector<char> inflate(const uint8_t* p, size_t len, size_t limit)
         {
-            size_t bucketsPerHash = m_hashTable.size() / N_HASH;
+            bio::filtering_streambuf<bio::input> in;
+            in.push(bio::zlib_decompressor());
+            in.push(bio::array_source((const char*)p, len));
+            std::vector<char> raw;
+            char chunk[4096];
+            for (std::streamsize n; (n = in.sgetn(chunk, sizeof(chunk))) > 0; ) {
+                if (raw.size() + n > limit) {
+                    BOOST_THROW_EXCEPTION(Error("Received IBF is too big!"));
+                }
+                raw.insert(raw.end(), chunk, chunk + n);
+            }
+            return raw;
+        }
 
-            for (size_t i = 0; i < N_HASH; i++) {
-                size_t startEntry = i * bucketsPerHash;
-                uint32_t h = murmurHash3(i, key);
-                HashTableEntry& entry =
-                        m_hashTable.at(startEntry + (h % bucketsPerHash));
-                entry.count += plusOrMinus;
-                entry.keySum ^= key;
-                entry.keyCheck ^= murmurHash3(N_HASHCHECK, key);
+        static uint8_t* putVarint(uint8_t* p, uint32_t v) noexcept
+        {
+            while (v >= 0x80) {
+                *p++ = (v & 0x7F) | 0x80;
+                v >>= 7;
             }
+            *p++ = v;
+            return p;
         }
 
-        std::vector<HashTableEntry> m_hashTable;
-    };
+        static uint8_t* putLE32(uint8_t* p, uint32_t v) noexcept
+        {
+            p[0] = v;
+            p[1] = v >> 8;
+            p[2] = v >> 16;
+            p[3] = v >> 24;
+            return p + 4;
+        }
 
-    static inline bool operator==(const IBLT& iblt1, const IBLT& iblt2)
-    {
-        auto iblt1HashTable = iblt1.getHashTable();
-        auto iblt2HashTable = iblt2.getHashTable();
-        if (iblt1HashTable.size() != iblt2HashTable.size()) {
-            return false;
+        static uint32_t getVarint(const uint8_t*& p, const uint8_t* end)
+        {
+            uint32_t v = 0;
+            for (int shift = 0; shift < 35; shift += 7) {
+                if (p == end) {
+                    break;
+                }
+                uint8_t b = *p++;
+                v |= (uint32_t)(b & 0x7F) << shift;
+                if ((b & 0x80) == 0) {
+                    return v;
+                }
+            }
+            BOOST_THROW_EXCEPTION(Error("Received IBF is truncated!"));
         }
 
-        size_t N = iblt1HashTable.size();
+        static uint32_t getLE32(const uint8_t*& p, const uint8_t* end)
+        {
+            if (end - p < 4) {
+                BOOST_THROW_EXCEPTION(Error("Received IBF is truncated!"));
+            }
+            uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+            p += 4;
+            return v;
+        }
 
-        for (size_t i = 0; i < N; i++) {
-            if (iblt1HashTable[i].count != iblt2HashTable[i].count ||
-                iblt1HashTable[i].keySum != iblt2HashTable[i].keySum ||
-                iblt1HashTable[i].keyCheck != iblt2HashTable[i].keyCheck)
-                return false;
+        void decodeCompact(const uint8_t* p, const uint8_t* end, bool adoptSize)
+        {
+            auto n = getVarint(p, end);
+            if (adoptSize) {
+                adopt(n);
+            }
+            if (n != size()) {
+                BOOST_THROW_EXCEPTION(Error("Received IBF cannot be decoded!"));
+            }
+            std::fill(m_count.begin(), m_count.end(), 0);
+            std::fill(m_keySum.begin(), m_keySum.end(), 0);
+            std::fill(m_keyCheck.begin(), m_keyCheck.end(), 0);
+            size_t i = 0;
+            while (p != end) {
+                uint8_t header = *p++;
+                size_t gap = header >> 3;
+                uint32_t zz = header & 7;
+                if (gap == 31) {
+                    gap += getVarint(p, end);
+                }
+                if (zz == 7) {
+                    zz += getVarint(p, end);
+                }
+                i += gap;
+                if (i >= size()) {
+                    BOOST_THROW_EXCEPTION(Error("Received IBF cannot be decoded!"));
+                }
+                m_count[i] = (int32_t)(zz >> 1) ^ -(int32_t)(zz & 1);
+                m_keySum[i] = getLE32(p, end);
+                m_keyCheck[i] = getLE32(p, end);
+                i++;
+            }
+        }
+
+        /**
+         * @brief peel the table of size() cells in 'count', 'keySum' and
+         *        'keyCheck' (this one's or a copy of it) in place
+         *
+         * Only the cells touched by a peeled key are re-examined, so the
+         * cost is proportional to the number of entries rather than table
+         * size times number of passes.
+         */
+        bool peelCells(int32_t* count, uint32_t* keySum, uint32_t* keyCheck,
+                       PeelBuffers& out) const
+        {
+            out.clear();
+            simd::findUnitCounts(count, size(), out.worklist);
+
+            // a cell that's empty, or pure but not for 'key' (see badPeers)
+            const auto bad = [&](uint32_t key, size_t i) {
+                if (count[i] == 0 && keySum[i] == 0 && keyCheck[i] == 0) {
+                    return true;
+                }
+                return (count[i] == 1 || count[i] == -1) &&
+                       keyCheck[i] == murmurHash3(N_HASHCHECK, keySum[i]) && keySum[i] != key;
+            };
+            while (!out.worklist.empty()) {
+                size_t cellIdx = out.worklist.back();
+                out.worklist.pop_back();
+
+                int32_t c = count[cellIdx];
+                if (c != 1 && c != -1) {
+                    continue;
+                }
+                uint32_t key = keySum[cellIdx];
+                uint32_t check = murmurHash3(N_HASHCHECK, key);
+                if (keyCheck[cellIdx] != check) {
+                    continue;
+                }
+                size_t idx[N_HASH];
+                buckets(key, idx);
+                if (bad(key, idx[0]) || bad(key, idx[1]) || bad(key, idx[2]) ||
+                    (idx[0] != cellIdx && idx[1] != cellIdx && idx[2] != cellIdx)) {
+                    std::cerr << "error - invalid iblt: badPeers for entry:"
+                              << HashTableEntry{c, key, keyCheck[cellIdx]} << "\n";
+                    return false;
+                }
+                (c == 1 ? out.positive : out.negative).push_back(key);
+                // a valid table can't hold more distinct keys than cells
+                if (out.positive.size() + out.negative.size() > size()) {
+                    std::cerr << "error - invalid iblt: peeling doesn't terminate\n";
+                    return false;
+                }
+                for (auto i : idx) {
+                    count[i] -= c;
+                    keySum[i] ^= key;
+                    keyCheck[i] ^= check;
+                    if (count[i] == 1 || count[i] == -1) {
+                        out.worklist.push_back(i);
+                    }
+                }
+            }
+            out.complete = true;
+            for (size_t i = 0; i < size() && out.complete; i++) {
+                out.complete = count[i] == 0 && keySum[i] == 0 && keyCheck[i] == 0;
+            }
+            return true;
         }
-        return true;
-    }
+
+        /**
+         * @brief the cell index of 'key' in each of the N_HASH subtables
+         *        (same as hash0, hash1, hash2)
+         */
+        void buckets(uint32_t key, size_t (&idx)[N_HASH]) const noexcept
+        {
+            size_t bucketsPerHash = size() / N_HASH;
+            for (size_t i = 0; i < N_HASH; i++) {
+                idx[i] = i * bucketsPerHash + murmurHash3(i, key) % bucketsPerHash;
+            }
+        }
+
+        void update(int plusOrMinus, uint32_t key)
+        {
+            size_t idx[N_HASH];
+            buckets(key, idx);
+            update(plusOrMinus, key, idx, murmurHash3(N_HASHCHECK, key));
+        }
+
+        void update(int plusOrMinus, uint32_t key, const size_t (&idx)[N_HASH],
+                    uint32_t check) noexcept
+        {
+            for (auto i : idx) {
+                m_count[i] += plusOrMinus;
+                m_keySum[i] ^= key;
+                m_keyCheck[i] ^= check;
+            }
+        }
+
+        void resize(size_t nEntries)
+        {
+            m_count.resize(nEntries);
+            m_keySum.resize(nEntries);
+            m_keyCheck.resize(nEntries);
+        }
+
+        std::vector<int32_t> m_count;
+        std::vector<uint32_t> m_keySum;
+        std::vector<uint32_t> m_keyCheck;
+        uint64_t m_version{0};
+    };
 
     static inline bool operator!=(const IBLT& iblt1, const IBLT& iblt2)
     {
         return !(iblt1 == iblt2);
     }
 
+    /**
+     * @brief insert (+1) or erase (-1) 'key' in every table of 'levels'
+     *
+     * Whether IBLT::erase rejects a key (see badPeers) depends on the
+     * table's size, so the check is made for all the levels first and an
+     * erase any of them rejects is applied to none. The levels always
+     * hold the same keys.
+     *
+     * @return false if the erase was rejected
+     */
+    static inline bool updateLevels(std::vector<IBLT>& levels, int plusOrMinus, uint32_t key)
+    {
+        if (plusOrMinus < 0 &&
+            std::any_of(levels.begin(), levels.end(),
+                        [key](const IBLT& l) { return l.badPeers(key); })) {
+            std::cerr << "error - invalid iblt erase: badPeers for key "
+                      << std::hex << key << "\n";
+            return false;
+        }
+        for (auto& l : levels) {
+            l.apply(plusOrMinus, key);
+        }
+        return true;
+    }
+
     static inline std::ostream& operator<<(std::ostream& out, const HashTableEntry& hte)
     {
         out << std::dec << std::setw(5) << hte.count << std::hex << std::setw(9)
@@ -482,10 +1005,10 @@ namespace syncps {
         }
         std::ostringstream rslt{};
         rslt << " @" << std::hex << rep;
-        auto hte = iblt.getHashTable().at(rep);
+        auto hte = iblt.cell(rep);
         if (hte.isEmpty()) {
             rslt << "!";
-        } else if (iblt.getHashTable().at(idx).keySum != hte.keySum) {
+        } else if (iblt.cell(idx).keySum != hte.keySum) {
             rslt << (hte.isPure()? "?" : "*");
         }
         return rslt.str();
@@ -493,7 +1016,7 @@ namespace syncps {
 
     static inline std::string prtPeers(const IBLT& iblt, size_t idx)
     {
-        auto hte = iblt.getHashTable().at(idx);
+        auto hte = iblt.cell(idx);
         if (! hte.isPure()) {
             // can only get the peers of 'pure' entries
             return "";
@@ -506,10 +1029,8 @@ namespace syncps {
     static inline std::ostream& operator<<(std::ostream& out, const IBLT& iblt)
     {
         out << "idx count keySum keyCheck\n";
-        auto idx = 0;
-        for (const auto& hte : iblt.getHashTable()) {
-            out << std::hex << std::setw(2) << idx << hte << prtPeers(iblt, idx) << "\n";
-            idx++;
+        for (size_t idx = 0; idx < iblt.size(); idx++) {
+            out << std::hex << std::setw(2) << idx << iblt.cell(idx) << prtPeers(iblt, idx) << "\n";
         }
         return out;
     }
@@ -0,0 +1,75 @@
+/*
+ * Small fixed-capacity LRU map (see syncps.h).
+ *
+ * Entries live in a list kept in recency order (most recent first) and
+ * are indexed by a hash map, so find and insert are O(1). Inserting into a
+ * full cache drops the least recently used entry.
+ */
+
+#ifndef SYNCPS_LRU_CACHE_HPP
+#define SYNCPS_LRU_CACHE_HPP
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace syncps {
+
+    template<typename Key, typename Value, typename Hash = std::hash<Key>>
+    class LruCache {
+    public:
+        explicit LruCache(size_t capacity) : m_capacity(capacity) {}
+
+        /**
+         * @brief the value for 'key' (which becomes the most recently
+         *        used) or nullptr. Pointers are invalidated by insert.
+         */
+        Value *find(const Key &key) {
+            auto i = m_index.find(key);
+            if (i == m_index.end()) {
+                return nullptr;
+            }
+            m_entries.splice(m_entries.begin(), m_entries, i->second);
+            return &i->second->second;
+        }
+
+        /**
+         * @brief add or replace the value for 'key'
+         */
+        void insert(const Key &key, Value value) {
+            if (m_capacity == 0) {
+                return;
+            }
+            if (auto i = m_index.find(key); i != m_index.end()) {
+                i->second->second = std::move(value);
+                m_entries.splice(m_entries.begin(), m_entries, i->second);
+                return;
+            }
+            if (m_entries.size() >= m_capacity) {
+                m_index.erase(m_entries.back().first);
+                m_entries.pop_back();
+            }
+            m_entries.emplace_front(key, std::move(value));
+            m_index.emplace(key, m_entries.begin());
+        }
+
+        void clear() {
+            m_index.clear();
+            m_entries.clear();
+        }
+
+        size_t size() const { return m_entries.size(); }
+
+    private:
+        using Entries = std::list<std::pair<Key, Value>>;
+
+        size_t m_capacity;
+        Entries m_entries;
+        std::unordered_map<Key, typename Entries::iterator, Hash> m_index;
+    };
+
+}  // namespace syncps
+
+#endif  // SYNCPS_LRU_CACHE_HPP
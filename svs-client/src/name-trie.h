@@ -0,0 +1,148 @@
+/*
+ * Name-component trie with longest-prefix match (see syncps.h).
+ *
+ * Each node is one name component. A prefix can hold several values (e.g.,
+ * several subscribers to one topic) and a generic component whose value is
+ * "*" matches any single component, so /position/ndn/<*> matches every
+ * /position/ndn/<platoon>/... name.
+ */
+
+#ifndef SYNCPS_NAME_TRIE_HPP
+#define SYNCPS_NAME_TRIE_HPP
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <ndn-cxx/name.hpp>
+
+namespace syncps {
+
+    template<typename T>
+    class NameTrie {
+    public:
+        // the values stored under one prefix
+        struct Entry {
+            ndn::Name prefix;
+            std::vector<T> values;
+        };
+
+        /**
+         * @brief true if 'c' is the single-component wildcard "*"
+         */
+        static bool isWildcard(const ndn::name::Component &c) {
+            return c.isGeneric() && c.value_size() == 1 && c.value()[0] == '*';
+        }
+
+        /**
+         * @brief the entry for 'prefix', created (empty) if needed
+         */
+        Entry &operator[](const ndn::Name &prefix) {
+            auto n = &m_root;
+            for (const auto &c : prefix) {
+                auto &child = isWildcard(c) ? n->wildcard : n->children[c];
+                if (!child) {
+                    child = std::make_unique<Node>();
+                }
+                n = child.get();
+            }
+            if (!n->entry) {
+                n->entry = std::make_unique<Entry>(Entry{prefix, {}});
+                ++m_size;
+            }
+            return *n->entry;
+        }
+
+        /**
+         * @brief remove the entry for 'prefix' (if any) and any nodes
+         *        that no longer lead to an entry.
+         *
+         * @return true if there was an entry
+         */
+        bool erase(const ndn::Name &prefix) {
+            return erase(m_root, prefix, 0);
+        }
+
+        /**
+         * @brief the entry with the longest prefix of 'name' or nullptr
+         *
+         * An exact component match is preferred over a wildcard when both
+         * lead to equally long prefixes.
+         */
+        const Entry *longestMatch(const ndn::Name &name) const {
+            const Entry *best = nullptr;
+            size_t bestLen = 0;
+            match(m_root, name, 0, best, bestLen);
+            return best;
+        }
+
+        size_t size() const { return m_size; }
+
+        bool empty() const { return m_size == 0; }
+
+    private:
+        struct Node {
+            std::map<ndn::name::Component, std::unique_ptr<Node>> children;
+            std::unique_ptr<Node> wildcard;
+            std::unique_ptr<Entry> entry;
+
+            bool isLeaf() const { return children.empty() && !wildcard; }
+        };
+
+        static void match(const Node &n, const ndn::Name &name, size_t depth,
+                          const Entry *&best, size_t &bestLen) {
+            if (n.entry && (best == nullptr || depth > bestLen)) {
+                best = n.entry.get();
+                bestLen = depth;
+            }
+            if (depth == name.size()) {
+                return;
+            }
+            if (auto c = n.children.find(name[depth]); c != n.children.end()) {
+                match(*c->second, name, depth + 1, best, bestLen);
+            }
+            if (n.wildcard) {
+                match(*n.wildcard, name, depth + 1, best, bestLen);
+            }
+        }
+
+        bool erase(Node &n, const ndn::Name &prefix, size_t depth) {
+            if (depth == prefix.size()) {
+                if (!n.entry) {
+                    return false;
+                }
+                n.entry.reset();
+                --m_size;
+                return true;
+            }
+            const auto &c = prefix[depth];
+            std::unique_ptr<Node> *child;
+            typename decltype(n.children)::iterator it;
+            if (isWildcard(c)) {
+                child = &n.wildcard;
+            } else if (it = n.children.find(c); it != n.children.end()) {
+                child = &it->second;
+            } else {
+                return false;
+            }
+            if (!*child || !erase(**child, prefix, depth + 1)) {
+                return false;
+            }
+            if (!(*child)->entry && (*child)->isLeaf()) {
+                if (isWildcard(c)) {
+                    n.wildcard.reset();
+                } else {
+                    n.children.erase(it);
+                }
+            }
+            return true;
+        }
+
+        Node m_root;
+        size_t m_size{0};
+    };
+
+}  // namespace syncps
+
+#endif  // SYNCPS_NAME_TRIE_HPP
@@ -0,0 +1,245 @@
+/*
+ * Topic-partitioned sync (see syncps.h).
+ *
+ * A single SyncPubsub reconciles every publication under its sync prefix,
+ * so each node's IBLT, active set and sync replies grow with the total
+ * traffic of the network. PartitionedSyncPubsub runs one SyncPubsub per
+ * topic partition (e.g., /position/ndn/platoon0), each with its own IBLT,
+ * active set and sync prefix (<syncPrefix>/<partition>), so a node only
+ * carries the partitions it subscribes to or deliberately relays.
+ */
+
+#ifndef SYNCPS_PARTITIONED_SYNCPS_HPP
+#define SYNCPS_PARTITIONED_SYNCPS_HPP
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "syncps.h"
+
+namespace syncps {
+
+    class PartitionedSyncPubsub {
+    public:
+        using Error = SyncPubsub::Error;
+        using ConfigureCb = std::function<void(SyncPubsub &)>;
+
+        /**
+         * @brief constructor
+         *
+         * No partition is synced until it's joined, either explicitly or
+         * by subscribing to a topic. The other parameters are passed to the
+         * SyncPubsub of each partition.
+         *
+         * @param face application's face
+         * @param syncPrefix prefix of the partitions' sync prefixes
+         */
+        PartitionedSyncPubsub(ndn::Face &face, Name syncPrefix,
+                              IsExpiredCb isExpired, FilterPubsCb filterPubs,
+                              ndn::time::milliseconds syncInterestLifetime = 4_s,
+                              size_t expectedNumEntries = 85,
+                              size_t ibltLevels = 3)
+                : m_face(face),
+                  m_syncPrefix(std::move(syncPrefix)),
+                  m_isExpired(std::move(isExpired)),
+                  m_filterPubs(std::move(filterPubs)),
+                  m_syncInterestLifetime(syncInterestLifetime),
+                  m_expectedNumEntries(expectedNumEntries),
+                  m_ibltLevels(ibltLevels) {}
+
+        /**
+         * @brief apply 'cb' to every partition, including those joined later
+         *
+         * Use this for the SyncPubsub setters (interest lifetime, reply
+         * segments, rate control, ...).
+         */
+        PartitionedSyncPubsub &configure(ConfigureCb &&cb) {
+            for (auto &p : m_partitions) {
+                cb(*p.second);
+            }
+            m_configure.push_back(std::move(cb));
+            return *this;
+        }
+
+        /**
+         * @brief sync 'partition' (if not already synced)
+         *
+         * Publications under 'partition' are then reconciled with peers and
+         * relayed whether or not anything local subscribes to them.
+         * Partitions can't be nested in one another since their sync
+         * prefixes would overlap.
+         *
+         * @return the partition's SyncPubsub
+         */
+        SyncPubsub &join(const Name &partition) {
+            if (auto p = m_partitions.find(partition); p != m_partitions.end()) {
+                return *p->second;
+            }
+            if (auto outer = findPartition(partition); outer != m_partitions.end()) {
+                BOOST_THROW_EXCEPTION(Error("partition " + partition.toUri() +
+                                            " is inside partition " + outer->first.toUri()));
+            }
+            if (auto inner = m_partitions.lower_bound(partition);
+                    inner != m_partitions.end() && partition.isPrefixOf(inner->first)) {
+                BOOST_THROW_EXCEPTION(Error("partition " + partition.toUri() +
+                                            " contains partition " + inner->first.toUri()));
+            }
+            NDN_LOG_INFO("join partition: " << partition);
+            auto sync = std::make_unique<SyncPubsub>(
+                    m_face, Name(m_syncPrefix).append(partition), m_isExpired,
+                    m_filterPubs, m_syncInterestLifetime, m_expectedNumEntries,
+                    m_ibltLevels);
+            for (const auto &cb : m_configure) {
+                cb(*sync);
+            }
+            return *m_partitions.emplace(partition, std::move(sync)).first->second;
+        }
+
+        /**
+         * @brief publish 'pub' in the partition containing its name
+         *
+         * @throws Error if no joined partition contains the name
+         */
+        PartitionedSyncPubsub &publish(Publication &&pub) {
+            partitionOf(pub.getName()).publish(std::move(pub));
+            return *this;
+        }
+
+        /**
+         * @brief publish a burst of publications (see SyncPubsub::publishBatch)
+         *
+         * The burst is split by partition and each partition gets one batch.
+         *
+         * @throws Error if no joined partition contains one of the names
+         *        (nothing is published in that case)
+         */
+        PartitionedSyncPubsub &publishBatch(std::vector<Publication> &&pubs) {
+            std::map<SyncPubsub *, std::vector<Publication>> batches;
+            for (const auto &pub : pubs) {
+                partitionOf(pub.getName());
+            }
+            for (auto &pub : pubs) {
+                batches[&partitionOf(pub.getName())].push_back(std::move(pub));
+            }
+            pubs.clear();
+            for (auto &b : batches) {
+                b.first->publishBatch(std::move(b.second));
+            }
+            return *this;
+        }
+
+        /**
+         * @brief subscribe to a topic
+         *
+         * A topic inside a joined partition subscribes there. A topic that
+         * spans joined partitions (e.g., /position when each platoon's
+         * positions are a partition) subscribes in each of them. Otherwise
+         * the topic becomes a new partition.
+         */
+        PartitionedSyncPubsub &subscribeTo(const Name &topic, UpdateCb &&cb) {
+            if (auto p = findPartition(topic); p != m_partitions.end()) {
+                p->second->subscribeTo(topic, std::move(cb));
+                return *this;
+            }
+            auto inner = m_partitions.lower_bound(topic);
+            if (inner == m_partitions.end() || !topic.isPrefixOf(inner->first)) {
+                join(topic).subscribeTo(topic, std::move(cb));
+                return *this;
+            }
+            for (; inner != m_partitions.end() && topic.isPrefixOf(inner->first); ++inner) {
+                inner->second->subscribeTo(topic, UpdateCb(cb));
+            }
+            return *this;
+        }
+
+        /**
+         * @brief remove all subscriptions to 'topic'
+         *
+         * The partitions stay joined (and keep relaying).
+         */
+        PartitionedSyncPubsub &unsubscribe(const Name &topic) {
+            if (auto p = findPartition(topic); p != m_partitions.end()) {
+                p->second->unsubscribe(topic);
+                return *this;
+            }
+            for (auto inner = m_partitions.lower_bound(topic);
+                    inner != m_partitions.end() && topic.isPrefixOf(inner->first); ++inner) {
+                inner->second->unsubscribe(topic);
+            }
+            return *this;
+        }
+
+        /**
+         * @brief the joined partitions
+         */
+        std::vector<Name> partitions() const {
+            std::vector<Name> names;
+            for (const auto &p : m_partitions) {
+                names.push_back(p.first);
+            }
+            return names;
+        }
+
+        /**
+         * @brief sync traffic counters summed over all partitions
+         */
+        SyncStats getStats() const {
+            SyncStats total{};
+            for (const auto &p : m_partitions) {
+                const auto &s = p.second->getStats();
+                total.interestsSent += s.interestsSent;
+                total.interestsCoalesced += s.interestsCoalesced;
+                total.interestsDelayed += s.interestsDelayed;
+                total.repliesSent += s.repliesSent;
+                total.repliesSuppressed += s.repliesSuppressed;
+                total.pushInterests += s.pushInterests;
+                total.needInterests += s.needInterests;
+                total.repliesDelayed += s.repliesDelayed;
+                total.repliesCancelled += s.repliesCancelled;
+                total.repliesShrunk += s.repliesShrunk;
+                total.repliesCached += s.repliesCached;
+                total.bytesSent += s.bytesSent;
+            }
+            return total;
+        }
+
+    private:
+        using Partitions = std::map<Name, std::unique_ptr<SyncPubsub>>;
+
+        // the joined partition that's a prefix of 'name' (there's at most one)
+        Partitions::iterator findPartition(const Name &name) {
+            for (auto n = name.size() + 1; n-- > 0; ) {
+                if (auto p = m_partitions.find(name.getPrefix(n)); p != m_partitions.end()) {
+                    return p;
+                }
+            }
+            return m_partitions.end();
+        }
+
+        SyncPubsub &partitionOf(const Name &name) {
+            auto p = findPartition(name);
+            if (p == m_partitions.end()) {
+                BOOST_THROW_EXCEPTION(Error("no partition for " + name.toUri()));
+            }
+            return *p->second;
+        }
+
+        ndn::Face &m_face;
+        Name m_syncPrefix;
+        IsExpiredCb m_isExpired;
+        FilterPubsCb m_filterPubs;
+        ndn::time::milliseconds m_syncInterestLifetime;
+        size_t m_expectedNumEntries;
+        size_t m_ibltLevels;
+        std::vector<ConfigureCb> m_configure{};
+        // partitions can't be left: a SyncPubsub's outstanding interests
+        // refer to it so each one lives as long as this object
+        Partitions m_partitions{};
+    };
+
+}  // namespace syncps
+
+#endif  // SYNCPS_PARTITIONED_SYNCPS_HPP
@@ -0,0 +1,288 @@
+/*
+ * Active publication store for SyncPubsub (see syncps.h).
+ *
+ * Publications are kept in one open-addressing (linear probing) table keyed
+ * by their hash, the same 32 bit value that goes in the IBLT. Each entry
+ * carries everything the sync protocol needs about a pub so a lookup is one
+ * probe sequence over a flat array. The Data objects themselves (together
+ * with their shared_ptr control blocks) are carved out of a slab whose
+ * chunks are recycled as pubs expire.
+ */
+
+#ifndef SYNCPS_PUB_STORE_HPP
+#define SYNCPS_PUB_STORE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include <ndn-cxx/data.hpp>
+#include <ndn-cxx/util/time.hpp>
+
+namespace syncps {
+
+    /**
+     * @brief free-list allocator of equal size chunks
+     *
+     * The chunk size is fixed by the first allocation; other sizes are
+     * passed through to operator new. Memory is only returned when the
+     * slab is destroyed.
+     */
+    class Slab {
+    public:
+        explicit Slab(size_t chunksPerBlock = 256) : m_chunksPerBlock(chunksPerBlock) {}
+
+        Slab(const Slab&) = delete;
+        Slab& operator=(const Slab&) = delete;
+
+        ~Slab() {
+            for (auto b : m_blocks) {
+                ::operator delete(b);
+            }
+        }
+
+        void* allocate(size_t size) {
+            if (m_size == 0) {
+                m_size = roundUp(std::max(size, sizeof(Chunk)));
+                m_request = size;
+            }
+            if (size != m_request) {
+                return ::operator new(size);
+            }
+            if (m_free == nullptr) {
+                grow();
+            }
+            auto c = m_free;
+            m_free = c->next;
+            return c;
+        }
+
+        void deallocate(void* p, size_t size) {
+            if (size != m_request) {
+                ::operator delete(p);
+                return;
+            }
+            auto c = static_cast<Chunk*>(p);
+            c->next = m_free;
+            m_free = c;
+        }
+
+    private:
+        struct Chunk {
+            Chunk* next;
+        };
+
+        static size_t roundUp(size_t n) {
+            constexpr size_t a = alignof(std::max_align_t);
+            return (n + a - 1) / a * a;
+        }
+
+        void grow() {
+            auto b = static_cast<char*>(::operator new(m_size * m_chunksPerBlock));
+            m_blocks.push_back(b);
+            for (size_t i = m_chunksPerBlock; i-- > 0; ) {
+                auto c = reinterpret_cast<Chunk*>(b + i * m_size);
+                c->next = m_free;
+                m_free = c;
+            }
+        }
+
+        size_t m_chunksPerBlock;
+        size_t m_request{0};    // the allocation size served from chunks
+        size_t m_size{0};       // chunk size (m_request rounded up)
+        Chunk* m_free{nullptr};
+        std::vector<char*> m_blocks;
+    };
+
+    /**
+     * @brief std allocator on a shared Slab
+     *
+     * Allocators hold a reference to their slab so objects (e.g., pubs
+     * still held by an app) can outlive the store that made them.
+     */
+    template<typename T>
+    class SlabAllocator {
+    public:
+        using value_type = T;
+
+        explicit SlabAllocator(std::shared_ptr<Slab> slab) : m_slab(std::move(slab)) {}
+
+        template<typename U>
+        SlabAllocator(const SlabAllocator<U>& other) : m_slab(other.m_slab) {}
+
+        T* allocate(size_t n) {
+            if (n != 1) {
+                return static_cast<T*>(::operator new(n * sizeof(T)));
+            }
+            return static_cast<T*>(m_slab->allocate(sizeof(T)));
+        }
+
+        void deallocate(T* p, size_t n) {
+            if (n != 1) {
+                ::operator delete(p);
+                return;
+            }
+            m_slab->deallocate(p, sizeof(T));
+        }
+
+        template<typename U>
+        bool operator==(const SlabAllocator<U>& other) const { return m_slab == other.m_slab; }
+
+        template<typename U>
+        bool operator!=(const SlabAllocator<U>& other) const { return m_slab != other.m_slab; }
+
+    private:
+        template<typename U> friend class SlabAllocator;
+        std::shared_ptr<Slab> m_slab;
+    };
+
+    /**
+     * @brief the active publications, by hash
+     */
+    class PubStore {
+    public:
+        using PubPtr = std::shared_ptr<const ndn::Data>;
+
+        enum : uint8_t {
+            Used = 0x80,    // slot holds an entry
+            Active = 0x01,  // pub can be sent to peers (hasn't expired)
+            Local = 0x02,   // we published it
+            Superseded = 0x04,  // replaced by its producer's newer pub (out of the iblt)
+        };
+
+        struct Entry {
+            PubPtr pub;
+            ndn::time::system_clock::TimePoint timestamp;   // see pubTimestamp in syncps.h
+            ndn::time::steady_clock::TimePoint expires;     // when it stops being Active
+            uint32_t hash;
+            uint8_t flags;
+            uint8_t priority;   // of the pub's topic (set by the caller)
+        };
+
+        explicit PubStore(size_t capacity = 256)
+                : m_slots(roundUpPow2(capacity)), m_slab(std::make_shared<Slab>()) {}
+
+        size_t size() const { return m_size; }
+
+        bool contains(uint32_t hash) const { return find(hash) != nullptr; }
+
+        /**
+         * @brief the entry for 'hash' or nullptr. Pointers are invalidated by
+         *        insert and erase.
+         */
+        Entry* find(uint32_t hash) {
+            for (size_t i = hash & mask(); ; i = (i + 1) & mask()) {
+                auto& e = m_slots[i];
+                if ((e.flags & Used) == 0) {
+                    return nullptr;
+                }
+                if (e.hash == hash) {
+                    return &e;
+                }
+            }
+        }
+
+        const Entry* find(uint32_t hash) const {
+            return const_cast<PubStore*>(this)->find(hash);
+        }
+
+        /**
+         * @brief call 'f' with each entry, in no particular order
+         */
+        template<typename F>
+        void forEach(F&& f) const {
+            for (const auto& e : m_slots) {
+                if ((e.flags & Used) != 0) {
+                    f(e);
+                }
+            }
+        }
+
+        /**
+         * @brief add 'pub' (which must not already be in the store)
+         *
+         * @return the new entry
+         */
+        Entry& insert(uint32_t hash, ndn::Data&& pub, uint8_t flags,
+                      ndn::time::system_clock::TimePoint timestamp,
+                      ndn::time::steady_clock::TimePoint expires) {
+            if ((m_size + 1) * 2 > m_slots.size()) {
+                rehash(m_slots.size() * 2);
+            }
+            size_t i = hash & mask();
+            while ((m_slots[i].flags & Used) != 0) {
+                i = (i + 1) & mask();
+            }
+            auto& e = m_slots[i];
+            e.timestamp = timestamp;
+            e.pub = std::allocate_shared<ndn::Data>(SlabAllocator<ndn::Data>(m_slab),
+                                                    std::move(pub));
+            e.expires = expires;
+            e.hash = hash;
+            e.flags = flags | Used;
+            e.priority = 0;
+            ++m_size;
+            return e;
+        }
+
+        /**
+         * @brief remove the entry for 'hash' (if any)
+         *
+         * Uses backward-shift deletion so probe sequences never need
+         * tombstones.
+         */
+        void erase(uint32_t hash) {
+            auto e = find(hash);
+            if (e == nullptr) {
+                return;
+            }
+            size_t i = e - m_slots.data();
+            for (size_t j = (i + 1) & mask(); (m_slots[j].flags & Used) != 0; j = (j + 1) & mask()) {
+                // entry j can move to hole i if i is on its probe path,
+                // i.e., its home slot isn't cyclically in (i, j].
+                size_t home = m_slots[j].hash & mask();
+                if (((j - home) & mask()) >= ((j - i) & mask())) {
+                    m_slots[i] = std::move(m_slots[j]);
+                    i = j;
+                }
+            }
+            m_slots[i] = Entry{};
+            --m_size;
+        }
+
+    private:
+        size_t mask() const { return m_slots.size() - 1; }
+
+        static size_t roundUpPow2(size_t n) {
+            size_t p = 16;
+            while (p < n) {
+                p <<= 1;
+            }
+            return p;
+        }
+
+        void rehash(size_t n) {
+            std::vector<Entry> old(n);
+            old.swap(m_slots);
+            for (auto& e : old) {
+                if ((e.flags & Used) != 0) {
+                    size_t i = e.hash & mask();
+                    while ((m_slots[i].flags & Used) != 0) {
+                        i = (i + 1) & mask();
+                    }
+                    m_slots[i] = std::move(e);
+                }
+            }
+        }
+
+        std::vector<Entry> m_slots;
+        size_t m_size{0};
+        std::shared_ptr<Slab> m_slab;
+    };
+
+}  // namespace syncps
+
+#endif  // SYNCPS_PUB_STORE_HPP
@@ -46,26 +46,9 @@ public:
                 std::bind(&SVSProgram::onMissingData, this, _1),
                 securityOptions);
 
-        std::vector<std::string> platoons;
-        auto p = m_participantPrefix.get(1).toUri();
-        platoons.push_back(p);
-        if (p == "platoon0") {
-            platoons.push_back("platoon3");
-            platoons.push_back("platoon1");
-        } else if (p == "platoon1") {
-            platoons.push_back("platoon0");
-            platoons.push_back("platoon2");
-        } else if (p == "platoon2") {
-            platoons.push_back("platoon1");
-            platoons.push_back("platoon3");
-        } else if (p == "platoon3") {
-            platoons.push_back("platoon2");
-            platoons.push_back("platoon0");
-        }
-
-        for (const auto p : platoons) {
+        for (const auto &topic : positionTopics()) {
             m_svspubsub->subscribeToPrefix(
-                ndn::Name("/position/ndn/" + p), [&](SVSPubSub::SubscriptionData subData) {
+                topic, [&](SVSPubSub::SubscriptionData subData) {
                     // Todo: Log received Data
                     const unsigned long data_size = subData.data.getContent().value_size();
                     const std::basic_string<char> content_str((char *) subData.data.getContent().value(), data_size);
@@ -14,7 +14,8 @@
  * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
  */
 
-#include "syncps.h"
+#include "partitioned-syncps.h"
+#include "syncps-options.h"
 #include "AbstractProgram.h"
 
 using namespace ndn::svs;
@@ -32,23 +33,37 @@ public:
     void instanciateSync() override {
         std::cout << "Create syncps Instance" << std::endl;
 
-        m_sync = std::make_shared<syncps::SyncPubsub>(
+        // see syncps-options.h for the features that can be switched on
+        const auto options = syncps::SyncOptions::fromEnv();
+        m_sync = std::make_shared<syncps::PartitionedSyncPubsub>(
                 face, m_syncPrefix, isExpired, filterPubs);
-        m_sync->setSyncInterestLifetime(ndn::time::milliseconds(1000));
-
-        m_sync->subscribeTo(
-                ndn::Name("/position"),
-                [&](const syncps::Publication &publication) {
-                    // Todo: Log received Data
-                    const unsigned long data_size = publication.getContent().value_size();
-                    const std::basic_string<char> content_str((char *) publication.getContent().value(), data_size);
-
-                    std::cout << "Got Data: " << publication.getName()
-                              << std::endl;
-
-                    BOOST_LOG_TRIVIAL(info) << "RECV_MSG::" << publication.getName().toUri();
-                }
-        );
+        m_sync->configure([options](syncps::SyncPubsub &sync) { options.apply(sync); });
+
+        // With partitions each topic subscribed below becomes a sync
+        // partition of its own so this node only reconciles its own and its
+        // neighbours' traffic. Otherwise everything is synced under the
+        // sync prefix itself and this node takes every platoon's positions.
+        std::vector<ndn::Name> positions{"/position"};
+        if (options.partitions) {
+            positions = positionTopics();
+        } else {
+            m_sync->join(ndn::Name());
+        }
+        for (const auto &topic : positions) {
+            m_sync->subscribeTo(
+                    topic,
+                    [&](const syncps::Publication &publication) {
+                        // Todo: Log received Data
+                        const unsigned long data_size = publication.getContent().value_size();
+                        const std::basic_string<char> content_str((char *) publication.getContent().value(), data_size);
+
+                        std::cout << "Got Data: " << publication.getName()
+                                  << std::endl;
+
+                        BOOST_LOG_TRIVIAL(info) << "RECV_MSG::" << publication.getName().toUri();
+                    }
+            );
+        }
 
         m_sync->subscribeTo(
                 ndn::Name("/voice").append(m_platoonPrefix),
@@ -71,39 +86,19 @@ public:
     static inline const syncps::FilterPubsCb filterPubs =
             [](auto &pOurs, auto &pOthers) mutable {
                 // Only reply if at least one of the pubs is ours. Order the
-                // reply by ours/others then most recent first (to minimize latency).
-                // Respond with as many pubs will fit in one Data.
+                // reply by ours/others (each comes most recent first, to
+                // minimize latency).
                 if (pOurs.empty()) {
                     return pOurs;
                 }
-                const auto cmp = [](const auto p1, const auto p2) {
-                    ndn::time::system_clock::TimePoint tp1 = (p1->getName()[-1].isTimestamp())
-                                                             ? p1->getName()[-1].toTimestamp()
-                                                             : p1->getName()[-3].toTimestamp();
-                    ndn::time::system_clock::TimePoint tp2 = (p2->getName()[-1].isTimestamp())
-                                                             ? p2->getName()[-1].toTimestamp()
-                                                             : p2->getName()[-3].toTimestamp();
-                    return tp1 > tp2;
-                };
-                if (pOurs.size() > 1) {
-                    std::sort(pOurs.begin(), pOurs.end(), cmp);
-                }
-                std::sort(pOthers.begin(), pOthers.end(), cmp);
-                for (auto &p : pOthers) {
-                    pOurs.push_back(p);
-                }
+                pOurs.insert(pOurs.end(), pOthers.begin(), pOthers.end());
                 return pOurs;
             };
 
     static inline const syncps::IsExpiredCb isExpired =
-            [](auto p) {
-                if (p.getName()[-1].isTimestamp()) {
-                    auto dt = ndn::time::system_clock::now() - p.getName()[-1].toTimestamp();
-                    return dt >= syncps::maxPubLifetime + syncps::maxClockSkew || dt <= -syncps::maxClockSkew;
-                } else {
-                    auto dt = ndn::time::system_clock::now() - p.getName()[-3].toTimestamp();
-                    return dt >= syncps::maxPubLifetime + syncps::maxClockSkew || dt <= -syncps::maxClockSkew;
-                }
+            [](const auto &p) {
+                auto dt = ndn::time::system_clock::now() - syncps::pubTimestamp(p);
+                return dt >= syncps::maxPubLifetime + syncps::maxClockSkew || dt <= -syncps::maxClockSkew;
             };
 
     void publishData(const ndn::Data &data) override {
@@ -112,7 +107,7 @@ public:
     }
 
 protected:
-    std::shared_ptr<syncps::SyncPubsub> m_sync;
+    std::shared_ptr<syncps::PartitionedSyncPubsub> m_sync;
 
 };
 
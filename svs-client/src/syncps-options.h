@@ -0,0 +1,75 @@
+/*
+ * Opt-in syncps features for the evaluation programs.
+ *
+ * By default the programs sync the way the original code did: one
+ * SyncPubsub for the whole sync prefix, replies of a single Data, and
+ * the legacy iblt encoding. Each feature below is switched on by setting
+ * its environment variable (to anything). Apart from SYNCPS_SUPPRESS,
+ * all nodes of a run need the same settings.
+ *
+ *   SYNCPS_PARTITIONS  one SyncPubsub per platoon partition
+ *   SYNCPS_STREAMS     one iblt entry per producer stream (setStreamKey)
+ *   SYNCPS_SEGMENTS    replies of up to 8 Data (setMaxReplySegments)
+ *   SYNCPS_SUPPRESS    hold replies back up to 40ms (setReplySuppression)
+ *   SYNCPS_POLICIES    /position pubs replace their unit's previous one
+ *                      and live 10s (setTopicPolicy)
+ *   SYNCPS_COMPACT     compact iblt encoding (setIbltEncoding)
+ */
+
+#ifndef SYNCPS_OPTIONS_HPP
+#define SYNCPS_OPTIONS_HPP
+
+#include <cstdlib>
+
+#include "syncps.h"
+
+namespace syncps {
+
+    struct SyncOptions {
+        bool partitions{false};
+        bool streams{false};
+        bool segments{false};
+        bool suppress{false};
+        bool policies{false};
+        bool compact{false};
+
+        static SyncOptions fromEnv() {
+            const auto set = [](const char *var) { return std::getenv(var) != nullptr; };
+            SyncOptions o;
+            o.partitions = set("SYNCPS_PARTITIONS");
+            o.streams = set("SYNCPS_STREAMS");
+            o.segments = set("SYNCPS_SEGMENTS");
+            o.suppress = set("SYNCPS_SUPPRESS");
+            o.policies = set("SYNCPS_POLICIES");
+            o.compact = set("SYNCPS_COMPACT");
+            return o;
+        }
+
+        /**
+         * @brief configure 'sync' with the programs' interest lifetime and
+         *        the features that are switched on
+         */
+        void apply(SyncPubsub &sync) const {
+            sync.setSyncInterestLifetime(ndn::time::milliseconds(1000));
+            if (segments) {
+                sync.setMaxReplySegments(8);
+            }
+            if (suppress) {
+                sync.setReplySuppression(ndn::time::milliseconds(40));
+            }
+            if (policies) {
+                // a position (published every ~5s) replaces the unit's last one
+                sync.setTopicPolicy("/position", {ndn::time::seconds(10), 1, true});
+            }
+            if (streams) {
+                sync.setStreamKey(timestampStreamKey);
+            }
+            if (compact) {
+                sync.setIbltEncoding(IBLTEncoding::Compact);
+            }
+        }
+    };
+
+}  // namespace syncps
+
+#endif  // SYNCPS_OPTIONS_HPP
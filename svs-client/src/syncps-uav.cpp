@@ -14,7 +14,8 @@
  * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
  */
 
-#include "syncps.h"
+#include "partitioned-syncps.h"
+#include "syncps-options.h"
 
 #include <thread>
 #include <ndn-cxx/util/random.hpp>
@@ -49,9 +50,22 @@ public:
     void instanciateSync() {
         std::cout << "Create syncps Instance" << std::endl;
 
-        m_sync = std::make_shared<syncps::SyncPubsub>(
+        // see syncps-options.h for the features that can be switched on
+        const auto options = syncps::SyncOptions::fromEnv();
+        m_sync = std::make_shared<syncps::PartitionedSyncPubsub>(
                 face, m_syncPrefix, isExpired, filterPubs);
-        m_sync->setSyncInterestLifetime(ndn::time::milliseconds(1000));
+        m_sync->configure([options](syncps::SyncPubsub &sync) { options.apply(sync); });
+
+        if (options.partitions) {
+            // The UaV relays every platoon's partitions (the clients only
+            // sync their own platoon's and their neighbours')
+            for (const auto &platoon : {"platoon0", "platoon1", "platoon2", "platoon3"}) {
+                m_sync->join(ndn::Name("/position/ndn").append(platoon));
+                m_sync->join(ndn::Name("/voice/ndn").append(platoon));
+            }
+        } else {
+            m_sync->join(ndn::Name());
+        }
 
         m_sync->subscribeTo("/position", [](const syncps::Publication& pub){
             std::cout << "GOT: " << pub.getName() << std::endl;
@@ -61,35 +75,15 @@ public:
 
     static inline const syncps::FilterPubsCb filterPubs =
             [](auto &pOurs, auto &pOthers) mutable {
-                // Always attempt to send back everything
-                const auto cmp = [](const auto p1, const auto p2) {
-                    ndn::time::system_clock::TimePoint tp1 = (p1->getName()[-1].isTimestamp())
-                                                             ? p1->getName()[-1].toTimestamp()
-                                                             : p1->getName()[-3].toTimestamp();
-                    ndn::time::system_clock::TimePoint tp2 = (p2->getName()[-1].isTimestamp())
-                                                             ? p2->getName()[-1].toTimestamp()
-                                                             : p2->getName()[-3].toTimestamp();
-                    return tp1 > tp2;
-                };
-                if (pOurs.size() > 1) {
-                    std::sort(pOurs.begin(), pOurs.end(), cmp);
-                }
-                std::sort(pOthers.begin(), pOthers.end(), cmp);
-                for (auto &p : pOthers) {
-                    pOurs.push_back(p);
-                }
+                // Always attempt to send back everything, ours first
+                pOurs.insert(pOurs.end(), pOthers.begin(), pOthers.end());
                 return pOurs;
             };
 
     static inline const syncps::IsExpiredCb isExpired =
-            [](auto p) {
-                if (p.getName()[-1].isTimestamp()) {
-                    auto dt = ndn::time::system_clock::now() - p.getName()[-1].toTimestamp();
-                    return dt >= syncps::maxPubLifetime + syncps::maxClockSkew || dt <= -syncps::maxClockSkew;
-                } else {
-                    auto dt = ndn::time::system_clock::now() - p.getName()[-3].toTimestamp();
-                    return dt >= syncps::maxPubLifetime + syncps::maxClockSkew || dt <= -syncps::maxClockSkew;
-                }
+            [](const auto &p) {
+                auto dt = ndn::time::system_clock::now() - syncps::pubTimestamp(p);
+                return dt >= syncps::maxPubLifetime + syncps::maxClockSkew || dt <= -syncps::maxClockSkew;
             };
 
 protected:
@@ -99,7 +93,7 @@ protected:
     ndn::security::SigningInfo m_signingInfo;
     ndn::KeyChain m_keyChain;
     ndn::svs::MemoryDataStore m_dataStore;
-    std::shared_ptr<syncps::SyncPubsub> m_sync;
+    std::shared_ptr<syncps::PartitionedSyncPubsub> m_sync;
 
 };
 
@@ -20,13 +20,18 @@
 #ifndef SYNCPS_SYNCPS_HPP
 #define SYNCPS_SYNCPS_HPP
 
+#include <algorithm>
 #include <cstring>
 #include <functional>
 #include <limits>
 #include <map>
+#include <optional>
+#include <queue>
 #include <random>
 #include <unordered_map>
+#include <unordered_set>
 
+#include <ndn-cxx/encoding/encoding-buffer.hpp>
 #include <ndn-cxx/face.hpp>
 #include <ndn-cxx/security/key-chain.hpp>
 #include <ndn-cxx/security/validator-null.hpp>
@@ -36,6 +41,11 @@
 #include <ndn-cxx/util/time.hpp>
 
 #include "iblt.h"
+#include "lru-cache.h"
+#include "name-trie.h"
+#include "pub-store.h"
+#include "timer-wheel.h"
+#include "token-bucket.h"
 
 namespace syncps {
     NDN_LOG_INIT(syncps.SyncPubsub);
@@ -47,8 +57,9 @@ namespace syncps {
 
     namespace tlv {
         enum {
-            syncpsContent = 129
-        }; // tlv for block of publications
+            syncpsContent = 129,        // tlv for block of publications
+            syncpsDiffEstimate = 130    // estimated difference size (in a syncpsContent)
+        };
     } // namespace tlv
 
     constexpr int maxPubSize = 1300;    // max payload in Data (approximate)
@@ -56,6 +67,29 @@ namespace syncps {
     using namespace ndn::literals::time_literals;
     constexpr ndn::time::milliseconds maxPubLifetime = 120_s;
     constexpr ndn::time::milliseconds maxClockSkew = 1_s;
+    constexpr ndn::time::milliseconds segmentInterestLifetime = 500_ms;
+    constexpr size_t maxReplySegments = 64;     // max Data in a segmented reply
+    constexpr unsigned segmentRetries = 2;      // re-requests of a lost segment
+    // publication lifecycle timer resolution & wheel size (one turn covers a
+    // pub's whole lifecycle)
+    constexpr ndn::time::milliseconds pubTimerTick = 250_ms;
+    constexpr size_t pubTimerSlots = maxPubLifetime * 2 / pubTimerTick + 1;
+    // each IBLT level holds this many times the entries of the one below
+    constexpr size_t ibltLevelGrowth = 4;
+    // sync interests sent at a raised level before stepping back down one
+    constexpr unsigned ibltLevelHold = 4;
+    // largest iblt component we'll put in an interest (max NDN packet is 8800)
+    constexpr size_t maxIbltComponentSize = 7000;
+    // peer sync states kept for notifying them of new pubs (see setPeerPush)
+    constexpr size_t maxRecentPeers = 16;
+    // signed replies kept for answering repeats of an interest
+    constexpr size_t replyCacheSize = 32;
+    // iblt changes logged for pending interests before their differences
+    // are brought up to date (see updateIblt)
+    constexpr size_t maxIbltLog = 1024;
+    // min time between sync interests sent to pull pubs a peer showed us
+    // we lack (see handleInterest)
+    constexpr ndn::time::milliseconds needInterestInterval = 100_ms;
 
 /**
  * @brief app callback when new publications arrive
@@ -68,11 +102,107 @@ namespace syncps {
     using IsExpiredCb = std::function<bool(const Publication &)>;
 /**
  * @brief app callback to filter peer publication requests
+ *
+ * It gets our pubs and others' pubs that the peer lacks, each in topic
+ * priority order then newest first (by pubTimestamp) and cut down to about
+ * what one reply can carry, and returns the pubs to send in priority order.
  */
     using PubPtr = std::shared_ptr<const Publication>;
     using VPubPtr = std::vector<PubPtr>;
     using FilterPubsCb = std::function<VPubPtr(VPubPtr &, VPubPtr &)>;
 
+/**
+ * @brief a publication's place in its producer's stream
+ *        (see SyncPubsub::setStreamKey)
+ */
+    struct StreamKey {
+        Name producer;
+        uint64_t seq;       // increases with each pub of the producer
+    };
+    using StreamKeyCb = std::function<std::optional<StreamKey>(const Publication &)>;
+
+/**
+ * @brief the time a pub was made: its name's last timestamp component, e.g.
+ *        the <ts> of /position/<unit>/<ts> and /voice/<unit>/<ts>/v=0/seg=0.
+ *        Zero (the epoch) if the name has none.
+ *
+ * SyncPubsub works this out once per pub, when it's added.
+ */
+    inline ndn::time::system_clock::TimePoint pubTimestamp(const Publication &pub) {
+        const auto &name = pub.getName();
+        for (auto i = name.size(); i-- > 0; ) {
+            if (name[i].isTimestamp()) {
+                return name[i].toTimestamp();
+            }
+        }
+        return {};
+    }
+
+/**
+ * @brief StreamKeyCb for names with a timestamp component, e.g.
+ *        /position/<unit>/<ts> and /voice/<unit>/<ts>/v=0/seg=0. The
+ *        producer is the name up to the last timestamp and the timestamp
+ *        (in us) is the sequence number.
+ */
+    inline std::optional<StreamKey> timestampStreamKey(const Publication &pub) {
+        const auto &name = pub.getName();
+        for (auto i = name.size(); i-- > 0; ) {
+            if (name[i].isTimestamp()) {
+                auto ts = name[i].toTimestamp().time_since_epoch();
+                return StreamKey{name.getPrefix(i), uint64_t(
+                        ndn::time::duration_cast<ndn::time::microseconds>(ts).count())};
+            }
+        }
+        return std::nullopt;
+    }
+
+/**
+ * @brief how the pubs of a topic are handled (see SyncPubsub::setTopicPolicy)
+ */
+    struct TopicPolicy {
+        // how long a pub stays active (at most maxPubLifetime). Pubs whose
+        // timestamp is older than that when they arrive are ignored.
+        ndn::time::milliseconds lifetime{maxPubLifetime};
+        // replies carry higher priority pubs first
+        uint8_t priority{0};
+        // a pub replaces the older pubs of its producer (the name up to
+        // its last timestamp), which leave the iblt and active set at once
+        bool latestWins{false};
+    };
+
+/**
+ * @brief sync traffic shaping (see SyncPubsub::setRateControl).
+ *        The defaults send everything as soon as it's ready.
+ */
+    struct SyncRateControl {
+        // sync interest requests within this window of an already
+        // scheduled one are merged into it
+        ndn::time::milliseconds coalesce{0};
+        // uniform random extra delay added to each scheduled sync interest
+        ndn::time::milliseconds jitter{0};
+        // token bucket over sync interests and replies (0 = unlimited)
+        double bytesPerSecond{0};
+        size_t burstBytes{8800};
+    };
+
+/**
+ * @brief sync traffic counters (see SyncPubsub::getStats)
+ */
+    struct SyncStats {
+        uint64_t interestsSent{};       // sync interests sent
+        uint64_t interestsCoalesced{};  // send requests merged into another send
+        uint64_t interestsDelayed{};    // sends pushed back by the rate limit
+        uint64_t repliesSent{};         // sync Data sent (including segments)
+        uint64_t repliesSuppressed{};   // replies not sent due to the rate limit
+        uint64_t pushInterests{};       // sync interests sent at once for recent peers
+        uint64_t needInterests{};       // sync interests sent early to pull pubs we lack
+        uint64_t repliesDelayed{};      // replies held back for suppression ...
+        uint64_t repliesCancelled{};    // ... then dropped since others sent our pubs
+        uint64_t repliesShrunk{};       // ... then trimmed of pubs others sent
+        uint64_t repliesCached{};       // replies resent from the signed reply cache
+        uint64_t bytesSent{};           // wire bytes of all of the above
+    };
+
 /**
  * @brief sync a lifetime-bounded set of publications among
  *        an arbitrary set of nodes.
@@ -106,17 +236,22 @@ namespace syncps {
          * @param syncPrefix The ndn name prefix for sync interest/data
          * @param syncInterestLifetime lifetime of the sync interest
          * @param expectedNumEntries expected entries in IBF
+         * @param ibltLevels number of IBLTs kept, each ibltLevelGrowth times
+         *        bigger than the last. Sync interests carry the smallest
+         *        one unless a peer reports that our difference is too big
+         *        to decode with it.
          */
         SyncPubsub(ndn::Face &face, Name syncPrefix,
                    IsExpiredCb isExpired, FilterPubsCb filterPubs,
                    ndn::time::milliseconds syncInterestLifetime = 4_s,
-                   size_t expectedNumEntries = 85)  // = 128/1.5 (see detail/iblt.hpp)
+                   size_t expectedNumEntries = 85,  // = 128/1.5 (see detail/iblt.hpp)
+                   size_t ibltLevels = 3)
                 : m_face(face),
                   m_syncPrefix(std::move(syncPrefix)),
                   m_expectedNumEntries(expectedNumEntries),
                   m_validator(ndn::security::v2::getAcceptAllValidator()), //XXX
                   m_scheduler(m_face.getIoService()),
-                  m_iblt(expectedNumEntries),
+                  m_iblts(makeLevels(expectedNumEntries, ibltLevels)),
                   m_signingInfo(ndn::security::SigningInfo::SIGNER_TYPE_SHA256),
                   m_isExpired{std::move(isExpired)}, m_filterPubs{std::move(filterPubs)},
                   m_syncInterestLifetime(syncInterestLifetime),
@@ -139,18 +274,29 @@ namespace syncps {
          * @param pub the object to publish
          */
         SyncPubsub &publish(Publication &&pub) {
-            m_keyChain.sign(pub, m_signingInfo); //XXX
-            if (isKnown(pub)) {
-                NDN_LOG_WARN("republish of '" << pub.getName() << "' ignored");
-            } else {
-                NDN_LOG_INFO("Publish: " << pub.getName());
-                ++m_publications;
-                addToActive(std::move(pub), true);
-                // new pub may let us respond to pending interest(s).
-                if (!m_delivering) {
-                    sendSyncInterest();
-                    handleInterests();
-                }
+            if (addLocalPub(std::move(pub))) {
+                publicationsAdded();
+            }
+            return *this;
+        }
+
+        /**
+         * @brief handle a burst of new publications from app
+         *
+         * Same as calling 'publish' on each of 'pubs' except that a single
+         * sync interest is sent and pending interests are checked once,
+         * after all of them have been added.
+         *
+         * @param pubs the objects to publish
+         */
+        SyncPubsub &publishBatch(std::vector<Publication> &&pubs) {
+            bool added = false;
+            for (auto &pub : pubs) {
+                added |= addLocalPub(std::move(pub));
+            }
+            pubs.clear();
+            if (added) {
+                publicationsAdded();
             }
             return *this;
         }
@@ -159,14 +305,16 @@ namespace syncps {
          * @brief subscribe to a subtopic
          *
          * Calls 'cb' on each new publication to 'topic' arriving
-         * from some external source.
+         * from some external source. A publication goes to every callback
+         * of the longest subscribed topic that's a prefix of its name.
+         * A topic component of "*" matches any one name component.
          *
          * @param  topic the topic
          */
         SyncPubsub &subscribeTo(const Name &topic, UpdateCb &&cb) {
-            // add to subscription dispatch table. NOTE that an existing
-            // subscription to 'topic' will be changed to the new callback.
-            m_subscription[topic] = std::move(cb);
+            // add to subscription dispatch table. Callbacks already
+            // subscribed to 'topic' are kept.
+            m_subscription[topic].values.push_back(std::move(cb));
             NDN_LOG_INFO("subscribeTo: " << topic);
             return *this;
         }
@@ -174,7 +322,7 @@ namespace syncps {
         /**
          * @brief unsubscribe to a subtopic
          *
-         * A subscription to 'topic', if any, is removed.
+         * All subscriptions to 'topic', if any, are removed.
          *
          * @param  topic the topic
          */
@@ -194,6 +342,160 @@ namespace syncps {
             return *this;
         }
 
+        /**
+         * @brief set the max number of Data segments in a sync reply
+         *
+         * With the default of 1 a sync interest is answered with a single
+         * Data of at most ~maxPubSize bytes. With n > 1, a larger difference
+         * is answered with a train of up to n segments (/<interest>/seg=k)
+         * whose first segment answers the interest. The requester fetches
+         * the rest with an AIMD window, so the train is paced by how well
+         * the requester's link is delivering them.
+         *
+         * @param n max segments per reply (1 to maxReplySegments)
+         */
+        SyncPubsub &setMaxReplySegments(size_t n) {
+            m_maxReplySegments = std::clamp<size_t>(n, 1, maxReplySegments);
+            m_replyCache.clear();
+            return *this;
+        }
+
+        /**
+         * @brief set how sync traffic is shaped
+         *
+         * Requests to send a sync interest (after publishing, receiving a
+         * reply, or pubs expiring) are delayed by up to 'coalesce' plus a
+         * random 'jitter' so bursts of them, and the same event seen by
+         * many nodes, turn into fewer interests. When the token bucket is
+         * in debt, sync interests wait for it and replies are held back
+         * (the peer's interest stays pending).
+         *
+         * @param rc the shaping parameters
+         */
+        SyncPubsub &setRateControl(const SyncRateControl &rc) {
+            m_rateControl = rc;
+            m_txBucket = TxBucket(rc.bytesPerSecond, rc.burstBytes);
+            return *this;
+        }
+
+        /**
+         * @brief let nodes sharing a broadcast link suppress duplicate replies
+         *
+         * Each reply is held back for a random time of up to
+         * maxDelay / (number of the peer's missing pubs we hold), so nodes
+         * that can cover more of a peer's difference tend to answer first.
+         * While a reply is held we listen, through our forwarder, for other
+         * nodes' replies to the same interest. Once validated, the pubs such
+         * a reply carries are delivered to us and removed from our reply. If
+         * none are left our reply is cancelled. SyncStats counts delayed,
+         * cancelled and shrunk replies.
+         *
+         * @param maxDelay longest hold time (0 = reply at once)
+         */
+        SyncPubsub &setReplySuppression(ndn::time::milliseconds maxDelay) {
+            m_replyDelay = maxDelay;
+            return *this;
+        }
+
+        /**
+         * @brief notify recently seen peers of new local pubs
+         *
+         * A peer's sync interest that we couldn't answer is only pending
+         * until it times out, and a pub published after that waits for
+         * the peer's next interest. With notification on, the iblts of the
+         * last maxRecentPeers such interests, and when they were seen, are
+         * kept until a sync interest lifetime past their expiry. When we
+         * publish and one of those peers lacks a pub of ours, our sync
+         * interest goes out at once, skipping the rate control's coalesce
+         * window and jitter (but not its byte rate). The peer sees what it
+         * lacks in the difference and sends its sync interest for it (see
+         * pullNeeded), which we answer as usual. Nothing is sent
+         * unsolicited, since forwarders drop unsolicited Data.
+         *
+         * With the default rate control our sync interest already goes
+         * out at once on publish, so this only matters with coalescing or
+         * jitter (see setRateControl).
+         *
+         * @param minInterval min time between notifications for a peer (0 = off)
+         */
+        SyncPubsub &setPeerPush(ndn::time::milliseconds minInterval) {
+            m_peerPushInterval = minInterval;
+            if (minInterval == 0_ms) {
+                m_recentPeers.clear();
+            }
+            return *this;
+        }
+
+        /**
+         * @brief sync traffic counters
+         */
+        const SyncStats &getStats() const { return m_stats; }
+
+        /**
+         * @brief set the wire encoding of the IBLT in our sync interests
+         *
+         * The default is Legacy, the only one peers running the original
+         * code can decode. If every peer runs this code the compact ones
+         * give smaller interests (CompactZlib is smaller for sparse tables).
+         *
+         * @param encoding one of IBLTEncoding
+         */
+        SyncPubsub &setIbltEncoding(IBLTEncoding encoding) {
+            m_ibltEncoding = encoding;
+            m_ibltComponentVersion = std::numeric_limits<uint64_t>::max();
+            return *this;
+        }
+
+        /**
+         * @brief sync per-producer stream summaries instead of single pubs
+         *
+         * 'key' places each publication in its producer's stream. The iblt
+         * then holds one entry per stream, a hash of the producer and its
+         * latest sequence number, rather than one per pub. A peer whose
+         * entry for a stream differs from ours is offered the stream's
+         * active pubs after the seq its entry stands for (all of them if
+         * we don't recognize it), oldest first so its entry can only
+         * advance over pubs it has. Pubs 'key' gives no stream for are
+         * synced individually. All members of a sync group must use the
+         * same setting.
+         *
+         * @param key stream of a pub (nullptr turns the mode off)
+         * @throws Error if any publications have been added already
+         */
+        SyncPubsub &setStreamKey(StreamKeyCb key) {
+            if (m_pubs.size() != 0) {
+                BOOST_THROW_EXCEPTION(Error("setStreamKey with active publications"));
+            }
+            m_streamKey = std::move(key);
+            m_replyCache.clear();
+            return *this;
+        }
+
+        /**
+         * @brief set the lifetime, reply priority and replacement of the
+         *        pubs under 'topic'
+         *
+         * A pub gets the policy of the longest topic that's a prefix of its
+         * name (a "*" component matches any one component) or else the
+         * default TopicPolicy. All nodes need the same policies and they
+         * have to be set before anything is published.
+         *
+         * @throws Error if there are publications or the lifetime isn't
+         *         in (0, maxPubLifetime]
+         */
+        SyncPubsub &setTopicPolicy(const Name &topic, const TopicPolicy &policy) {
+            if (m_pubs.size() != 0) {
+                BOOST_THROW_EXCEPTION(Error("setTopicPolicy with active publications"));
+            }
+            if (policy.lifetime <= 0_ms || policy.lifetime > maxPubLifetime) {
+                BOOST_THROW_EXCEPTION(Error("setTopicPolicy lifetime out of range for " +
+                                            topic.toUri()));
+            }
+            m_policies[topic].values.assign(1, policy);
+            NDN_LOG_INFO("setTopicPolicy: " << topic);
+            return *this;
+        }
+
         /**
          * @brief schedule a callback after some time
          *
@@ -220,6 +522,7 @@ namespace syncps {
          */
         SyncPubsub &setSigningInfo(const SigningInfo &si) {
             m_signingInfo = si;
+            m_replyCache.clear();
             return *this;
         }
 
@@ -242,6 +545,57 @@ namespace syncps {
         const ndn::security::v2::Validator &getValidator() { return m_validator; }
 
     private:
+        // a sync reply: one Data or a train of segments
+        using ReplyData = std::vector<std::shared_ptr<ndn::Data>>;
+
+        // what a reply depends on: the interest it answers and the state of
+        // ours it was made from
+        struct ReplyKey {
+            uint64_t name;      // hashIBLT64 of the interest name
+            uint64_t version;   // ibltVersion()
+            uint64_t epoch;     // m_activeEpoch
+
+            bool operator==(const ReplyKey &o) const {
+                return name == o.name && version == o.version && epoch == o.epoch;
+            }
+        };
+        struct ReplyKeyHash {
+            size_t operator()(const ReplyKey &k) const {
+                return std::hash<uint64_t>()(k.name ^ (k.version * 0x9e3779b97f4a7c15ULL) ^
+                                             (k.epoch << 32));
+            }
+        };
+
+        /**
+         * @brief sign a publication from app and add it to the active set
+         *
+         * @return false if it was already there
+         */
+        bool addLocalPub(Publication &&pub) {
+            m_keyChain.sign(pub, m_signingInfo); //XXX
+            auto hash = hashPub(pub);
+            if (isKnown(hash)) {
+                NDN_LOG_WARN("republish of '" << pub.getName() << "' ignored");
+                return false;
+            }
+            NDN_LOG_INFO("Publish: " << pub.getName());
+            ++m_publications;
+            addToActive(std::move(pub), hash, true);
+            return true;
+        }
+
+        /**
+         * @brief tell peers about newly published pubs
+         */
+        void publicationsAdded() {
+            // new pubs may let us respond to pending interest(s).
+            if (!m_delivering) {
+                if (!notifyPeers()) {
+                    requestSyncInterest();
+                }
+                handleInterests();
+            }
+        }
 
         /**
          * @brief reexpress our current sync interest so it doesn't time out
@@ -251,9 +605,43 @@ namespace syncps {
             // to allow for propagation and precessing delays.
             //
             // note: previously scheduled timer is automatically cancelled.
-            auto when = m_syncInterestLifetime - 20_ms;
+            scheduleSyncInterest(m_syncInterestLifetime - 20_ms);
+        }
+
+        /**
+         * @brief (re)schedule our next sync interest 'after' from now
+         */
+        void scheduleSyncInterest(ndn::time::nanoseconds after) {
+            // note: previously scheduled timer is automatically cancelled.
+            m_nextSyncInterest = ndn::time::steady_clock::now() + after;
             m_scheduledSyncInterestId =
-                    m_scheduler.schedule(when, [this] { sendSyncInterest(); });
+                    m_scheduler.schedule(after, [this] { sendSyncInterest(); });
+        }
+
+        /**
+         * @brief ask for a sync interest to be sent at least 'after' from now
+         *
+         * With the default rate control it goes out right away (or after
+         * 'after'). Otherwise the send is delayed by the coalesce window
+         * and jitter, and is absorbed by any send already scheduled to go
+         * out before then (including the periodic re-expression).
+         */
+        void requestSyncInterest(ndn::time::milliseconds after = 0_ms) {
+            auto delay = ndn::time::nanoseconds(after + m_rateControl.coalesce);
+            if (m_rateControl.jitter > 0_ms) {
+                delay += ndn::time::milliseconds(
+                        ndn::random::generateWord32() % (m_rateControl.jitter.count() + 1));
+            }
+            if (delay == 0_ms) {
+                sendSyncInterest();
+                return;
+            }
+            if (m_scheduledSyncInterestId &&
+                m_nextSyncInterest <= ndn::time::steady_clock::now() + delay) {
+                ++m_stats.interestsCoalesced;
+                return;
+            }
+            scheduleSyncInterest(delay);
         }
 
         /**
@@ -268,13 +656,25 @@ namespace syncps {
             if (m_registering) {
                 return;
             }
+            auto now = ndn::time::steady_clock::now();
+            if (!m_txBucket.ready(now)) {
+                ++m_stats.interestsDelayed;
+                scheduleSyncInterest(m_txBucket.wait(now));
+                return;
+            }
             // schedule the next send
             reExpressSyncInterest();
 
+            // drift back down to the smallest iblt that'll do
+            if (m_level > 0 && --m_levelHold == 0) {
+                --m_level;
+                m_levelHold = ibltLevelHold;
+            }
+
             // Build and ship the interest. Format is
             // /<sync-prefix>/<ourLatestIBF>
             ndn::Name name = m_syncPrefix;
-            m_iblt.appendToName(name);
+            name.append(ibltComponent());
 
             ndn::Interest syncInterest(name);
             m_currentInterest = ndn::random::generateWord32();
@@ -292,9 +692,62 @@ namespace syncps {
                                    },
                                    [](auto i, auto/*n*/) { NDN_LOG_INFO("Nack for " << i); },
                                    [](auto i) { NDN_LOG_INFO("Timeout for " << i); });
-            ++m_interestsSent;
+            countSent(syncInterest.wireEncode().size(), now);
+            ++m_stats.interestsSent;
             NDN_LOG_DEBUG("sendSyncInterest " << std::hex
-                                              << m_currentInterest << "/" << hashIBLT(name));
+                                              << m_currentInterest << "/" << m_ibltHash);
+        }
+
+        /**
+         * @brief our IBLT as a name component
+         *
+         * Periodic re-expressions mostly send an unchanged IBLT so the
+         * encoding (and its hash, for logging) is only redone after the
+         * IBLT's contents change.
+         */
+        const ndn::name::Component &ibltComponent() {
+            if (m_ibltComponentVersion != ibltVersion() || m_ibltComponentLevel != m_level) {
+                m_ibltComponent = m_iblts[m_level].toComponent(m_ibltEncoding);
+                // a big, well-filled level may not fit in an interest
+                while (m_level > 0 && m_ibltComponent.value_size() > maxIbltComponentSize) {
+                    m_ibltComponent = m_iblts[--m_level].toComponent(m_ibltEncoding);
+                }
+                m_ibltHash = murmurHash3(N_HASHCHECK, m_ibltComponent.value(),
+                                         m_ibltComponent.value_size());
+                m_ibltComponentVersion = ibltVersion();
+                m_ibltComponentLevel = m_level;
+            }
+            return m_ibltComponent;
+        }
+
+        static std::vector<IBLT> makeLevels(size_t expectedNumEntries, size_t levels) {
+            std::vector<IBLT> iblts;
+            for (size_t l = 0; l < std::max<size_t>(levels, 1); l++) {
+                iblts.emplace_back(expectedNumEntries);
+                expectedNumEntries *= ibltLevelGrowth;
+            }
+            return iblts;
+        }
+
+        // all levels change together so level 0 versions the set
+        uint64_t ibltVersion() const { return m_iblts[0].version(); }
+
+        /**
+         * @brief raise our sync interest level to one big enough for a
+         *        difference of 'estimate' entries
+         */
+        void raiseLevel(size_t estimate) {
+            size_t l = 0;
+            for (size_t n = m_expectedNumEntries; n < estimate && l + 1 < m_iblts.size();
+                 n *= ibltLevelGrowth) {
+                l++;
+            }
+            if (l > m_level) {
+                NDN_LOG_INFO("iblt level " << m_level << " -> " << l
+                             << " for difference of ~" << estimate);
+                m_level = l;
+            }
+            m_levelHold = ibltLevelHold;
         }
 
         /**
@@ -302,8 +755,24 @@ namespace syncps {
          */
         void sendSyncInterestSoon() {
             NDN_LOG_DEBUG("sendSyncInterestSoon");
-            m_scheduledSyncInterestId =
-                    m_scheduler.schedule(3_ms, [this] { sendSyncInterest(); });
+            requestSyncInterest(3_ms);
+        }
+
+        /**
+         * @brief account for 'bytes' of sync traffic sent at 'now'
+         */
+        void countSent(size_t bytes, ndn::time::steady_clock::TimePoint now) {
+            m_txBucket.consume(bytes, now);
+            m_stats.bytesSent += bytes;
+        }
+
+        /**
+         * @brief send a sync reply Data and account for it
+         */
+        void putReply(const ndn::Data &data) {
+            m_face.put(data);
+            countSent(data.wireEncode().size(), ndn::time::steady_clock::now());
+            ++m_stats.repliesSent;
         }
 
         /**
@@ -321,235 +790,1407 @@ namespace syncps {
                 // library looped back our interest
                 return;
             }
+            if (interest.getHopLimit() == 0) {
+                // another node listening for replies (see listenForReply)
+                return;
+            }
             const ndn::Name &name = interest.getName();
             NDN_LOG_DEBUG("onSyncInterest " << std::hex << interest.getNonce() << "/"
                                             << hashIBLT(name));
 
+            if (name.size() - prefixName.size() == 2 && name[-1].isSegment()) {
+                sendSegment(name);
+                return;
+            }
             if (name.size() - prefixName.size() != 1) {
                 NDN_LOG_INFO("invalid sync interest: " << interest);
                 return;
             }
-            if (!handleInterest(name)) {
-                // couldn't handle interest immediately - remember it until
-                // we satisfy it or it times out;
-                m_interests[name] = ndn::time::system_clock::now() +
-                                    m_syncInterestLifetime;
-            }
-        }
-
-        void handleInterests() {
-            NDN_LOG_DEBUG("handleInterests");
-            auto now = ndn::time::system_clock::now();
-            for (auto i = m_interests.begin(); i != m_interests.end();) {
-                const auto&[name, expires] = *i;
-                if (expires <= now || handleInterest(name)) {
-                    i = m_interests.erase(i);
-                } else {
-                    ++i;
+            // a repeat of an interest we answered in this same state gets the
+            // same signed reply without its iblt being decoded again (over
+            // our rate it's left to be kept pending below)
+            if (m_txBucket.ready(ndn::time::steady_clock::now())) {
+                if (const auto cached = m_replyCache.find(replyKey(name)); cached != nullptr) {
+                    resendReply(name, *cached);
+                    return;
                 }
             }
-        }
-
-        bool handleInterest(const ndn::Name &name) {
-            // 'Peeling' the difference between the peer's iblt & ours gives
-            // two sets:
-            //   have - (hashes of) items we have that they don't
-            //   need - (hashes of) items we need that they have
-            IBLT iblt(m_expectedNumEntries);
+            IBLT iblt(0);
             try {
-                iblt.initialize(name.get(-1));
+                iblt.decode(name.get(-1));
             } catch (const std::exception &e) {
                 NDN_LOG_WARN(e.what());
-                return true;
+                return;
             }
-            std::set<uint32_t> have;
-            std::set<uint32_t> need;
-            (m_iblt - iblt).listEntries(have, need);
-            NDN_LOG_DEBUG("handleInterest " << std::hex << hashIBLT(name)
-                                            << " need " << need.size() << ", have " << have.size());
-
-            // If we have things the other side doesn't, send as many as
-            // will fit in one Data. Make two lists of needed, active publications:
-            // ones we published and ones published by others.
-
-            VPubPtr pOurs, pOthers;
-            for (const auto hash : have) {
-                if (auto h = m_hash2pub.find(hash); h != m_hash2pub.end()) {
-                    // 2^0 bit of p->second is =0 if pub expired; 2^1 bit is 1 if we
-                    // did publication.
-                    if (const auto p = m_active.find(h->second); p != m_active.end()
-                                                                 && (p->second & 1U) != 0) {
-                        ((p->second & 2U) != 0 ? &pOurs : &pOthers)->push_back(h->second);
-                    }
+            // the peer can send any of our levels; its size tells which
+            auto level = std::find_if(m_iblts.begin(), m_iblts.end(),
+                                      [&iblt](const auto &l) { return l.size() == iblt.size(); });
+            if (level == m_iblts.end()) {
+                NDN_LOG_INFO("sync interest with unknown iblt size " << iblt.size());
+                return;
+            }
+            auto diff = *level - iblt;
+            if (!handleInterest(name, diff)) {
+                // couldn't handle interest immediately - remember it (and
+                // the decoded difference) until we satisfy it or it times out;
+                auto now = ndn::time::system_clock::now();
+                expireInterests(now);
+                auto expires = now + m_syncInterestLifetime;
+                m_interests.insert_or_assign(hashIBLT64(name), PendingInterest{
+                        name, expires, std::move(diff), ibltVersion()});
+                m_interestExpiry.emplace(expires, hashIBLT64(name));
+                if (m_interestExpiry.size() > 2 * m_interests.size() + 16) {
+                    compactInterestExpiry();
                 }
+                notePeer(name, size_t(level - m_iblts.begin()), std::move(iblt));
             }
-            pOurs = m_filterPubs(pOurs, pOthers);
-            if (pOurs.empty()) {
+        }
+
+        /**
+         * @brief remember the state of a peer whose interest we couldn't
+         *        answer (see setPeerPush)
+         */
+        void notePeer(const ndn::Name &name, size_t level, IBLT &&iblt) {
+            if (m_peerPushInterval == 0_ms) {
+                return;
+            }
+            const auto key = hashIBLT64(name);
+            if (m_recentPeers.size() >= maxRecentPeers && m_recentPeers.count(key) == 0) {
+                m_recentPeers.erase(std::min_element(
+                        m_recentPeers.begin(), m_recentPeers.end(),
+                        [](const auto &a, const auto &b) { return a.second.seen < b.second.seen; }));
+            }
+            auto &peer = m_recentPeers[key];
+            peer.level = level;
+            peer.iblt = std::move(iblt);
+            peer.seen = ndn::time::steady_clock::now();
+        }
+
+        /**
+         * @brief send our sync interest now if a recent peer whose interest
+         *        has expired lacks a pub of ours (see setPeerPush)
+         *
+         * Each peer is counted at most once per m_peerPushInterval.
+         *
+         * @return true if the interest was sent
+         */
+        bool notifyPeers() {
+            if (m_recentPeers.empty()) {
                 return false;
             }
-            ndn::Block pubs(tlv::syncpsContent);
-            for (const auto &p : pOurs) {
-                NDN_LOG_DEBUG("Send pub " << p->getName());
-                pubs.push_back((*(p)).wireEncode());
-                pubs.encode();
-                if (pubs.size() >= maxPubSize) {
-                    break;
+            expireInterests(ndn::time::system_clock::now());
+            const auto now = ndn::time::steady_clock::now();
+            bool notify = false;
+            for (auto p = m_recentPeers.begin(); p != m_recentPeers.end();) {
+                auto&[key, peer] = *p;
+                if (now - peer.seen > m_syncInterestLifetime * 2) {
+                    p = m_recentPeers.erase(p);
+                    continue;
+                }
+                ++p;
+                if (notify || m_interests.count(key) != 0 ||
+                    now - peer.pushed < m_peerPushInterval) {
+                    continue;
                 }
+                if (lacksOurs(m_iblts[peer.level] - peer.iblt)) {
+                    NDN_LOG_DEBUG("notify " << std::hex << key);
+                    peer.pushed = now;
+                    notify = true;
+                }
+            }
+            if (!notify) {
+                return false;
             }
-            pubs.encode();
-            sendSyncData(name, pubs);
+            ++m_stats.pushInterests;
+            sendSyncInterest();
             return true;
         }
 
         /**
-         * @brief Send a sync data packet responding to a sync interest.
+         * @brief true if the peer whose difference from us is 'diff' lacks
+         *        an active pub of ours (or, in stream mode, a stream summary)
          *
-         * Send a packet containing one or more publications that are known
-         * to be in our active set but not in the interest sender's set.
-         *
-         * @param name  is the name from the sync interest we're responding to
-         *              (data packet's base name)
-         * @param pubs  is the list of publications (data packet's payload)
+         * A difference too big to peel is taken to lack one.
          */
-        void sendSyncData(const ndn::Name &name, const ndn::Block &pubs) {
-            NDN_LOG_DEBUG("sendSyncData: " << name);
-            auto data = std::make_shared<ndn::Data>();
-            data->setName(name).setContent(pubs).setFreshnessPeriod(maxPubLifetime / 2);
-            m_keyChain.sign(*data, m_signingInfo);
-            m_face.put(*data);
+        bool lacksOurs(const IBLT &diff) {
+            if (!diff.listEntries(m_pushPeeled)) {
+                return true;
+            }
+            return std::any_of(m_pushPeeled.positive.begin(), m_pushPeeled.positive.end(),
+                               [this](auto h) {
+                                   if (m_streamSeqs.count(h) != 0) {
+                                       return true;
+                                   }
+                                   const auto e = m_pubs.find(h);
+                                   return e != nullptr && (e->flags & PubStore::Active) != 0 &&
+                                          (e->flags & PubStore::Local) != 0;
+                               });
         }
 
         /**
-         * @brief Process sync data after successful validation
-         *
-         * Add each item in Data content that we don't have to
-         * our list of active publications then notify the
-         * application about the updates.
+         * @brief drop pending interests that expired by 'now'
          *
-         * @param interest interest for which we got the data
-         * @param data     sync data content
+         * m_interestExpiry can hold stale records for interests that were
+         * answered or refreshed; those are skipped (and compacted away by
+         * onSyncInterest if they pile up).
          */
-        void onValidData(const ndn::Interest &interest, const ndn::Data &data) {
-            NDN_LOG_DEBUG("onValidData: " << std::hex << interest.getNonce() << "/"
-                                          << hashIBLT(interest.getName())
-                                          << " " << data.getName());
-
-            const ndn::Block &pubs(data.getContent().blockFromValue());
-            if (pubs.type() != tlv::syncpsContent) {
-                NDN_LOG_WARN("Sync Data with wrong content type " <<
-                                                                  pubs.type() << " ignored.");
-                return;
+        void expireInterests(ndn::time::system_clock::TimePoint now) {
+            while (!m_interestExpiry.empty() && m_interestExpiry.top().first <= now) {
+                const auto&[expires, key] = m_interestExpiry.top();
+                if (auto i = m_interests.find(key);
+                        i != m_interests.end() && i->second.expires == expires) {
+                    m_interests.erase(i);
+                }
+                m_interestExpiry.pop();
             }
+        }
 
-            // if publications result from handling this data we don't want to
+        /**
+         * @brief rebuild m_interestExpiry from m_interests
+         *
+         * Interests that are refreshed or answered leave stale records in
+         * the heap until they come due. Peers that re-express their
+         * interests much faster than the interest lifetime would make the
+         * heap grow far beyond the number of pending interests.
+         */
+        void compactInterestExpiry() {
+            std::vector<InterestExpiry> live;
+            live.reserve(m_interests.size());
+            for (const auto&[key, pi] : m_interests) {
+                live.emplace_back(pi.expires, key);
+            }
+            m_interestExpiry = decltype(m_interestExpiry)(std::greater<InterestExpiry>(),
+                                                          std::move(live));
+        }
+
+        /**
+         * @brief try to answer all the pending interests
+         *
+         * Each reply is named, and so signed, for its own interest. Peers
+         * whose interests carried the same iblt share one pending entry and
+         * so one Data.
+         */
+        void handleInterests() {
+            NDN_LOG_DEBUG("handleInterests");
+            expireInterests(ndn::time::system_clock::now());
+            catchUpInterests();
+            for (auto i = m_interests.begin(); i != m_interests.end();) {
+                ReplyPlan plan;
+                if (selectReply(i->second.name, i->second.diff, plan) &&
+                    replyTo(i->second.name, plan)) {
+                    i = m_interests.erase(i);
+                } else {
+                    ++i;
+                }
+            }
+        }
+
+        /**
+         * @brief bring the differences of all the pending interests up to
+         *        date with the changes to our iblt since they were last
+         *        looked at, then clear the log of those changes
+         */
+        void catchUpInterests() {
+            for (auto&[key, pi] : m_interests) {
+                for (auto v = pi.version; v < ibltVersion(); v++) {
+                    const auto&[plusOrMinus, hash] = m_ibltLog[v - m_ibltLogBase];
+                    pi.diff.apply(plusOrMinus, hash);
+                }
+                pi.version = ibltVersion();
+            }
+            m_ibltLog.clear();
+            m_ibltLogBase = ibltVersion();
+        }
+
+        /**
+         * @brief try to answer a sync interest
+         *
+         * @param name  the sync interest name
+         * @param diff  our iblt minus the one in the interest (left unchanged)
+         * @return true if the interest needs no further handling
+         */
+        bool handleInterest(const ndn::Name &name, const IBLT &diff) {
+            ReplyPlan plan;
+            return selectReply(name, diff, plan) && replyTo(name, plan);
+        }
+
+        // what selectReply picked to send in reply to a sync interest
+        struct ReplyPlan {
+            VPubPtr pubs;               // the pubs to send, in priority order
+            size_t estimate{0};         // the difference estimate to send (0 = none)
+            size_t covered{0};          // active entries of the difference we hold
+            std::vector<uint32_t> need; // entries the peer has that we lack
+        };
+
+        // a signed reply with the plan it was made from, so a repeat of the
+        // interest is handled like the first one
+        struct CachedReply {
+            ReplyData data;
+            ReplyPlan plan;
+        };
+
+        /**
+         * @brief answer a repeat of an interest we've already answered, in
+         *        the same state, with the same signed Data
+         *
+         * As for the first one, pubs the peer has that we lack are pulled
+         * and the reply is held back if replies are suppressed. ('cached' is
+         * a copy since sending can add to m_replyCache.)
+         */
+        void resendReply(const ndn::Name &name, CachedReply cached) {
+            pullNeeded(cached.plan.need);
+            if (m_replyDelay > 0_ms) {
+                delayReply(name, std::move(cached.plan), std::move(cached.data));
+                return;
+            }
+            putCachedReply(name, cached.data);
+        }
+
+        void putCachedReply(const ndn::Name &name, const ReplyData &reply) {
+            NDN_LOG_DEBUG("resend reply " << reply[0]->getName());
+            if (reply.size() > 1) {
+                keepSegments(name, reply);
+            }
+            putReply(*reply[0]);
+            ++m_stats.repliesCached;
+            // the peer moves on to a new state once it gets this
+            m_recentPeers.erase(hashIBLT64(name));
+        }
+
+        /**
+         * @brief work out what to send in reply to a sync interest
+         *
+         * @param name  the sync interest name
+         * @param diff  our iblt minus the one in the interest
+         * @param plan  set to what to send
+         * @return false if there's nothing to send
+         */
+        bool selectReply(const ndn::Name &name, const IBLT &diff, ReplyPlan &plan) {
+            // 'Peeling' the difference between the peer's iblt & ours gives
+            // two sets:
+            //   have - (hashes of) items we have that they don't
+            //   need - (hashes of) items we need that they have
+            diff.listEntries(m_peeled);
+            const auto& have = m_peeled.positive;
+            const auto& need = m_peeled.negative;
+            NDN_LOG_DEBUG("handleInterest " << std::hex << hashIBLT(name)
+                                            << " need " << need.size() << ", have " << have.size());
+            if (!need.empty()) {
+                pullNeeded(need);
+            }
+            plan.need = need;
+
+            // If we have things the other side doesn't, send as many as
+            // will fit in one Data. Make two lists of needed, active publications:
+            // ones we published and ones published by others.
+
+            Candidates cOurs, cOthers;
+            for (const auto hash : have) {
+                if (m_streamSeqs.count(hash) == 0) {
+                    addActive(hash, cOurs, cOthers);
+                }
+            }
+            StreamStarts starts;
+            if (!m_streams.empty()) {
+                addStreamPubs(m_peeled, cOurs, cOthers, starts);
+            }
+            plan.covered = cOurs.size() + cOthers.size();
+            // a stream's pubs have to go oldest first (see orderStreamPubs)
+            // so none can be left out
+            const size_t budget = m_streams.empty() ? maxPubSize * m_maxReplySegments
+                                                   : std::numeric_limits<size_t>::max();
+            auto pOurs = bestFirst(cOurs, budget);
+            auto pOthers = bestFirst(cOthers, budget);
+            pOurs = m_filterPubs(pOurs, pOthers);
+            if (!starts.empty()) {
+                keepStreamPrefixes(pOurs, starts);
+                orderStreamPubs(pOurs);
+            }
+
+            // If the difference was too big to peel completely and the peer
+            // could use a bigger iblt, tell it how big the difference looks
+            // (even if there are no pubs to send with that, as long as the
+            // filter would let us reply at all). Since it didn't peel it's
+            // taken to be more than 'diff' was sized for, otherwise an
+            // underestimate would leave the peer at a level that can't
+            // decode it.
+            plan.estimate = 0;
+            if (!m_peeled.complete && diff.size() < m_iblts.back().size() &&
+                (!pOurs.empty() || wouldReply())) {
+                plan.estimate = std::max(diff.estimateEntries(), diff.size() * 2 / 3 + 1);
+            }
+            plan.pubs = std::move(pOurs);
+            return !plan.pubs.empty() || plan.estimate != 0;
+        }
+
+        /**
+         * @brief true if m_filterPubs lets us reply to a peer that lacks
+         *        our newest active pubs
+         *
+         * Stands in for the filter when a difference doesn't peel, so a
+         * node that would never answer (e.g., one with no pubs of its own
+         * for a filter that only replies with those) doesn't send
+         * estimate-only replies either.
+         */
+        bool wouldReply() {
+            Candidates cOurs, cOthers;
+            m_pubs.forEach([&cOurs, &cOthers](const PubStore::Entry &e) {
+                if ((e.flags & PubStore::Active) != 0) {
+                    ((e.flags & PubStore::Local) != 0 ? &cOurs : &cOthers)->push_back(&e);
+                }
+            });
+            auto pOurs = bestFirst(cOurs, maxPubSize);
+            auto pOthers = bestFirst(cOthers, maxPubSize);
+            return !m_filterPubs(pOurs, pOthers).empty();
+        }
+
+        /**
+         * @brief send (or hold back) the reply selected for sync interest 'name'
+         *
+         * @return false if the rate limit kept it from going out
+         */
+        bool replyTo(const ndn::Name &name, ReplyPlan &plan) {
+            if (!m_txBucket.ready(ndn::time::steady_clock::now())) {
+                // over our rate: leave the interest pending
+                ++m_stats.repliesSuppressed;
+                return false;
+            }
+            if (m_replyDelay > 0_ms) {
+                delayReply(name, std::move(plan));
+            } else {
+                sendAndCache(name, replyKey(name), std::move(plan));
+            }
+            // the peer moves on to a new state once it gets this
+            m_recentPeers.erase(hashIBLT64(name));
+            return true;
+        }
+
+        /**
+         * @brief send the reply in 'plan' and cache it under 'key'
+         */
+        void sendAndCache(const ndn::Name &name, const ReplyKey &key, ReplyPlan &&plan) {
+            auto pubs = plan.pubs;  // packing uses them up
+            auto reply = sendReply(name, pubs, plan.estimate);
+            m_replyCache.insert(key, CachedReply{std::move(reply), std::move(plan)});
+        }
+
+        ReplyData sendReply(const ndn::Name &name, VPubPtr &pubs, size_t estimate) {
+            auto content = packReply(pubs, estimate);
+            if (content.size() == 1) {
+                return {sendSyncData(name, content[0])};
+            }
+            return sendSegmentedReply(name, content);
+        }
+
+        /**
+         * @brief pack 'pubs' into the content of up to m_maxReplySegments Data
+         */
+        std::vector<ndn::Block> packReply(VPubPtr &pubs, size_t estimate) {
+            std::vector<ndn::Block> content;
+            content.push_back(packPubs(pubs, estimate));
+            while (!pubs.empty() && content.size() < m_maxReplySegments) {
+                content.push_back(packPubs(pubs));
+            }
+            return content;
+        }
+
+        /**
+         * @brief hold a reply back (see setReplySuppression) and listen for
+         *        other nodes' replies to the same interest meanwhile
+         *
+         * The delay goes by how much of the difference we could cover, not
+         * by how many pubs fit in the reply, so a node holding more of what
+         * the peer lacks still tends to answer first when every reply is
+         * full.
+         *
+         * @param cached the signed reply to resend, for a repeat interest
+         */
+        void delayReply(const ndn::Name &name, ReplyPlan &&plan, ReplyData cached = {}) {
+            auto key = hashIBLT64(name);
+            if (m_delayedReplies.count(key) != 0) {
+                return;
+            }
+            auto us = m_replyDelay.count() * 1000 / std::max<size_t>(plan.covered, 1);
+            auto delay = ndn::time::microseconds(ndn::random::generateWord32() % (us + 1));
+            auto &r = m_delayedReplies[key];
+            r.name = name;
+            r.key = replyKey(name);
+            r.plan = std::move(plan);
+            r.cached = std::move(cached);
+            r.timer = m_scheduler.schedule(delay, [this, key] { sendDelayedReply(key); });
+            listenForReply(key, name);
+            ++m_stats.repliesDelayed;
+            NDN_LOG_DEBUG("delay reply to " << std::hex << hashIBLT(name) << " by " << delay.count() << "us");
+        }
+
+        void sendDelayedReply(uint64_t key) {
+            auto r = m_delayedReplies.find(key);
+            if (r == m_delayedReplies.end()) {
+                return;
+            }
+            auto name = std::move(r->second.name);
+            auto plan = std::move(r->second.plan);
+            auto cached = std::move(r->second.cached);
+            auto replyKey = r->second.key;
+            auto shrunk = r->second.shrunk;
+            m_delayedReplies.erase(r);  // also cancels the listen interests
+            // a reply trimmed of what others sent isn't what we'd send
+            // for this state next time
+            if (shrunk) {
+                sendReply(name, plan.pubs, plan.estimate);
+            } else if (!cached.empty()) {
+                putCachedReply(name, cached);
+            } else {
+                sendAndCache(name, replyKey, std::move(plan));
+            }
+        }
+
+        /**
+         * @brief overhear other nodes' replies to 'name' while our reply
+         *        to it (m_delayedReplies[key]) is held back
+         *
+         * The listen interest has a HopLimit of 1 since NFD drops one of 0.
+         * A neighbour's forwarder takes it down to 0 on arrival and sends it
+         * no further, and the apps there ignore it rather than take it for a
+         * sync interest (see onSyncInterest). Locally it joins the PIT entry
+         * of the peer's interest, so another node's reply to that reaches us
+         * too.
+         */
+        void listenForReply(uint64_t key, const ndn::Name &name) {
+            ndn::Interest listen(name);
+            listen.setCanBePrefix(true)
+                    .setMustBeFresh(true)
+                    .setHopLimit(1)
+                    .setInterestLifetime(m_replyDelay + 100_ms);
+            m_delayedReplies.at(key).listens.emplace_back(m_face.expressInterest(
+                    listen,
+                    [this, key](auto/*i*/, auto d) {
+                        m_validator.validate(d,
+                                             [this, key](auto d) { onOverheardReply(key, d); },
+                                             [](auto d, auto e) {
+                                                 NDN_LOG_INFO("Invalid: " << e << " Data " << d);
+                                             });
+                    },
+                    [](auto/*i*/, auto/*n*/) {},
+                    [](auto/*i*/) {}));
+        }
+
+        /**
+         * @brief another node answered an interest we're holding a reply
+         *        for: take the pubs it sent and drop them from our reply
+         *
+         * If it's the first segment of a segmented reply we listen for the
+         * rest of the segments too (the peer fetches them the same way).
+         */
+        void onOverheardReply(uint64_t key, const ndn::Data &data) {
+            auto initpubs = m_publications;
+            std::vector<uint32_t> sent;
+            if (!deliverPubs(data, &sent)) {
+                return;
+            }
+            if (initpubs != m_publications) {
+                handleInterests();
+            }
+            auto r = m_delayedReplies.find(key);
+            if (r == m_delayedReplies.end()) {
+                return;
+            }
+            const auto &name = data.getName();
+            const auto &last = data.getFinalBlock();
+            if (name.size() == r->second.name.size() + 1 && name[-1].isSegment() &&
+                name[-1].toSegment() == 0 && last && last->isSegment()) {
+                const auto n = std::min<uint64_t>(last->toSegment(), maxReplySegments);
+                for (uint64_t k = 1; k <= n; k++) {
+                    listenForReply(key, ndn::Name(r->second.name).appendSegment(k));
+                }
+            }
+            // the pubs it sent, as we hold them
+            std::unordered_set<const Publication *> sentPubs;
+            for (const auto hash : sent) {
+                if (const auto e = m_pubs.find(hash); e != nullptr) {
+                    sentPubs.insert(e->pub.get());
+                }
+            }
+            auto &pubs = r->second.plan.pubs;
+            auto n = pubs.size();
+            pubs.erase(std::remove_if(pubs.begin(), pubs.end(), [&sentPubs](const auto &p) {
+                return sentPubs.count(p.get()) != 0;
+            }), pubs.end());
+            if (pubs.empty()) {
+                NDN_LOG_DEBUG("reply to " << std::hex << hashIBLT(r->second.name) << " suppressed");
+                ++m_stats.repliesCancelled;
+                m_delayedReplies.erase(r);
+            } else if (pubs.size() < n) {
+                ++m_stats.repliesShrunk;
+                r->second.shrunk = true;
+            }
+        }
+
+        /**
+         * @brief the peer has pubs we lack: send our sync interest now
+         *        (at most once per needInterestInterval) so the peer can
+         *        answer it, rather than waiting for our next one.
+         *
+         * Entries for pubs we still hold (e.g., ones already erased from our
+         * iblt at end of life) or stream summaries we've gone past don't
+         * count.
+         */
+        void pullNeeded(const std::vector<uint32_t> &need) {
+            auto now = ndn::time::steady_clock::now();
+            if (now < m_nextNeedInterest ||
+                std::none_of(need.begin(), need.end(), [this](auto h) {
+                    return !isKnown(h) && m_streamSeqs.count(h) == 0;
+                })) {
+                return;
+            }
+            NDN_LOG_DEBUG("pull " << need.size() << " needed");
+            m_nextNeedInterest = now + needInterestInterval;
+            ++m_stats.needInterests;
+            requestSyncInterest();
+        }
+
+        // pubs that could go in a reply (valid until m_pubs changes)
+        using Candidates = std::vector<const PubStore::Entry *>;
+
+        /**
+         * @brief add the pub with hash 'hash' to 'cOurs' or 'cOthers' if
+         *        it's active
+         */
+        void addActive(uint32_t hash, Candidates &cOurs, Candidates &cOthers) const {
+            if (const auto e = m_pubs.find(hash); e != nullptr
+                                                  && (e->flags & PubStore::Active) != 0) {
+                ((e->flags & PubStore::Local) != 0 ? &cOurs : &cOthers)->push_back(e);
+            }
+        }
+
+        /**
+         * @brief the pubs of 'cands', highest priority then newest first,
+         *        up to the first one that reaches 'budget' bytes
+         *
+         * Uses the priorities and timestamps cached in the store and a heap,
+         * so only the pubs taken are ordered: O(n + k log n) rather than
+         * sorting (and parsing the names of) the whole difference for every
+         * reply.
+         */
+        static VPubPtr bestFirst(Candidates &cands, size_t budget) {
+            const auto worse = [](const PubStore::Entry *a, const PubStore::Entry *b) {
+                return a->priority != b->priority ? a->priority < b->priority
+                                                  : a->timestamp < b->timestamp;
+            };
+            std::make_heap(cands.begin(), cands.end(), worse);
+            VPubPtr pubs;
+            size_t used = 0;
+            for (auto end = cands.end(); end != cands.begin() && used < budget; --end) {
+                std::pop_heap(cands.begin(), end, worse);
+                const auto &pub = (*(end - 1))->pub;
+                used += pub->wireEncode().size();
+                pubs.push_back(pub);
+            }
+            return pubs;
+        }
+
+        // for each stream whose pubs are in a reply, the first of its pubs
+        // the peer may lack
+        using StreamStarts = std::vector<std::pair<const std::map<uint64_t, uint32_t> *,
+                                                   std::map<uint64_t, uint32_t>::const_iterator>>;
+
+        /**
+         * @brief add the active pubs of each stream whose summary the peer
+         *        lacks. If the peer's own summary of the stream is one we
+         *        recognize only the pubs after it are added. Where each
+         *        stream's pubs start is added to 'starts'.
+         */
+        void addStreamPubs(const PeelBuffers &peeled, Candidates &cOurs, Candidates &cOthers,
+                           StreamStarts &starts) const {
+            std::unordered_map<const Stream *, uint64_t> peerSeq;
+            for (const auto hash : peeled.negative) {
+                if (const auto s = m_streamSeqs.find(hash); s != m_streamSeqs.end()) {
+                    peerSeq[&s->second.first->second] = s->second.second;
+                }
+            }
+            for (const auto hash : peeled.positive) {
+                const auto s = m_streamSeqs.find(hash);
+                if (s == m_streamSeqs.end()) {
+                    continue;
+                }
+                const auto &st = s->second.first->second;
+                auto p = st.pubs.begin();
+                if (const auto ps = peerSeq.find(&st); ps != peerSeq.end()) {
+                    p = st.pubs.upper_bound(ps->second);
+                }
+                starts.emplace_back(&st.pubs, p);
+                for (; p != st.pubs.end(); ++p) {
+                    addActive(p->second, cOurs, cOthers);
+                }
+            }
+        }
+
+        /**
+         * @brief cut each stream's pubs in 'pubs' down to the ones before
+         *        the first active pub of the stream that the peer lacks
+         *        but 'pubs' doesn't have
+         *
+         * The filter may leave out some of a stream's pubs. A peer that
+         * got the newer ones anyway would take its summary past the ones
+         * it missed, which would then never be sent.
+         */
+        void keepStreamPrefixes(VPubPtr &pubs, const StreamStarts &starts) const {
+            // matched by pub: the stream holds the hashes the pubs were
+            // stored (and put in the iblt) under, so none are rehashed
+            std::unordered_set<const Publication *> in;
+            for (const auto &p : pubs) {
+                in.insert(p.get());
+            }
+            std::unordered_set<const Publication *> drop;
+            for (const auto &[stPubs, from] : starts) {
+                bool gap = false;
+                for (auto p = from; p != stPubs->end(); ++p) {
+                    const auto e = m_pubs.find(p->second);
+                    if (e == nullptr || (e->flags & PubStore::Active) == 0) {
+                        continue;
+                    }
+                    if (gap) {
+                        drop.insert(e->pub.get());
+                    } else if (in.count(e->pub.get()) == 0) {
+                        gap = true;
+                    }
+                }
+            }
+            if (!drop.empty()) {
+                pubs.erase(std::remove_if(pubs.begin(), pubs.end(), [&drop](const auto &p) {
+                    return drop.count(p.get()) != 0;
+                }), pubs.end());
+            }
+        }
+
+        /**
+         * @brief put each stream's pubs in 'pubs' in sequence order
+         *
+         * The pubs of a stream stay in the positions the filter gave
+         * them but the oldest goes first, so a reply that can't carry all
+         * of them never moves the peer's summary past one it didn't get.
+         */
+        void orderStreamPubs(VPubPtr &pubs) const {
+            std::map<Name, std::vector<std::pair<uint64_t, size_t>>> streams;
+            for (size_t i = 0; i < pubs.size(); i++) {
+                if (auto key = streamKey(*pubs[i])) {
+                    streams[key->producer].emplace_back(key->seq, i);
+                }
+            }
+            for (auto &st : streams) {
+                auto &v = st.second;
+                VPubPtr inSeq;
+                std::sort(v.begin(), v.end());
+                for (const auto &sp : v) {
+                    inSeq.push_back(pubs[sp.second]);
+                }
+                std::vector<size_t> slots;
+                for (const auto &sp : v) {
+                    slots.push_back(sp.second);
+                }
+                std::sort(slots.begin(), slots.end());
+                for (size_t k = 0; k < slots.size(); k++) {
+                    pubs[slots[k]] = inSeq[k];
+                }
+            }
+        }
+
+        /**
+         * @brief pack as many of 'pubs' (in priority order) as fit in one
+         *        syncpsContent block. Packed pubs are removed from 'pubs'.
+         *        A non-zero 'estimate' goes in front of them as a
+         *        syncpsDiffEstimate element.
+         *
+         * Pubs are taken strictly in order, never skipping one that doesn't
+         * fit for a later one, so a reply never carries a pub without the
+         * higher priority ones (or, for a stream, the older ones) before it.
+         * As before, the block is filled until it reaches maxPubSize so it
+         * may cross it with its last pub (this always sends at least one
+         * pub). Each pub's wire size is known up front so the block is
+         * encoded once, back to front, into a buffer of the exact size.
+         */
+        ndn::Block packPubs(VPubPtr& pubs, size_t estimate = 0) {
+            size_t n = 0;
+            size_t used = 0;
+            while (n < pubs.size() && used < maxPubSize) {
+                used += pubs[n++]->wireEncode().size();
+            }
+            ndn::EncodingBuffer enc(used + 4 * 9, 0);
+            for (size_t i = n; i-- > 0; ) {
+                const auto &wire = pubs[i]->wireEncode();
+                enc.prependByteArray(wire.wire(), wire.size());
+            }
+            if (estimate > 0) {
+                used += ndn::encoding::prependNonNegativeIntegerBlock(
+                        enc, tlv::syncpsDiffEstimate, estimate);
+            }
+            enc.prependVarNumber(used);
+            enc.prependVarNumber(tlv::syncpsContent);
+            for (size_t i = 0; i < n; i++) {
+                NDN_LOG_DEBUG("Send pub " << pubs[i]->getName());
+            }
+            pubs.erase(pubs.begin(), pubs.begin() + n);
+            return enc.block();
+        }
+
+        /**
+         * @brief answer sync interest 'name' with a train of Data segments
+         *        (see setMaxReplySegments), one per block of 'content'.
+         *
+         * Segment 0 answers the interest and all the segments are kept for
+         * about an interest lifetime so the requester (and any other peer
+         * whose interest carried the same iblt) can fetch the rest.
+         */
+        ReplyData sendSegmentedReply(const ndn::Name &name, const std::vector<ndn::Block> &content) {
+            ReplyData segments;
+            const auto last = ndn::name::Component::fromSegment(content.size() - 1);
+            for (size_t k = 0; k < content.size(); k++) {
+                auto data = std::make_shared<ndn::Data>(ndn::Name(name).appendSegment(k));
+                data->setContent(content[k]).setFreshnessPeriod(maxPubLifetime / 2)
+                        .setFinalBlock(last);
+                m_keyChain.sign(*data, m_signingInfo);
+                segments.push_back(std::move(data));
+            }
+            NDN_LOG_DEBUG("sendSegmentedReply: " << name << " " << content.size() << " segments");
+            keepSegments(name, segments);
+            putReply(*segments[0]);
+            return segments;
+        }
+
+        /**
+         * @brief serve the segments of our reply to 'name' for about an
+         *        interest lifetime
+         */
+        void keepSegments(const ndn::Name &name, const ReplyData &segments) {
+            auto now = ndn::time::system_clock::now();
+            for (auto r = m_replySegments.begin(); r != m_replySegments.end();) {
+                r = r->second.expires <= now ? m_replySegments.erase(r) : std::next(r);
+            }
+            auto &reply = m_replySegments[hashIBLT64(name)];
+            reply.expires = now + m_syncInterestLifetime;
+            reply.segments = segments;
+        }
+
+        /**
+         * @brief answer a segment interest /<sync-prefix>/<iblt>/seg=k
+         *        from the segments of a recent reply.
+         *
+         * Unknown or expired segments are ignored: the requester gives up on
+         * them and the pubs they carried show up in the difference of its
+         * next sync interest.
+         */
+        void sendSegment(const ndn::Name &name) {
+            auto r = m_replySegments.find(hashIBLT64(name.getPrefix(-1)));
+            if (r == m_replySegments.end()
+                || r->second.expires <= ndn::time::system_clock::now()) {
+                NDN_LOG_DEBUG("no reply segments for " << name);
+                return;
+            }
+            auto seg = name[-1].toSegment();
+            if (seg >= r->second.segments.size()) {
+                return;
+            }
+            if (!m_txBucket.ready(ndn::time::steady_clock::now())) {
+                // the requester treats this as a loss and slows down
+                ++m_stats.repliesSuppressed;
+                return;
+            }
+            NDN_LOG_DEBUG("sendSegment: " << name);
+            putReply(*r->second.segments[seg]);
+        }
+
+        /**
+         * @brief Send a sync data packet responding to a sync interest.
+         *
+         * Send a packet containing one or more publications that are known
+         * to be in our active set but not in the interest sender's set.
+         *
+         * @param name  is the name from the sync interest we're responding to
+         *              (data packet's base name)
+         * @param pubs  is the list of publications (data packet's payload)
+         */
+        std::shared_ptr<ndn::Data> sendSyncData(const ndn::Name &name, const ndn::Block &pubs) {
+            NDN_LOG_DEBUG("sendSyncData: " << name);
+            auto data = std::make_shared<ndn::Data>();
+            data->setName(name).setContent(pubs).setFreshnessPeriod(maxPubLifetime / 2);
+            m_keyChain.sign(*data, m_signingInfo);
+            putReply(*data);
+            return data;
+        }
+
+        /**
+         * @brief Process sync data after successful validation
+         *
+         * Add each item in Data content that we don't have to
+         * our list of active publications then notify the
+         * application about the updates.
+         *
+         * @param interest interest for which we got the data
+         * @param data     sync data content
+         */
+        void onValidData(const ndn::Interest &interest, const ndn::Data &data) {
+            NDN_LOG_DEBUG("onValidData: " << std::hex << interest.getNonce() << "/"
+                                          << hashIBLT(interest.getName())
+                                          << " " << data.getName());
+
+            auto initpubs = m_publications;
+            if (!deliverPubs(data)) {
+                return;
+            }
+            // If this is our currently active sync interest, send an
+            // interest to replace the one consumed by the Data. If the Data
+            // is the first of a segmented reply, that waits until the rest
+            // of the segments have been fetched.
+            // If deliveries resulted in new publications, try to satisfy
+            // pending peer interests.
+            if (interest.getNonce() == m_currentInterest && !fetchSegments(data)) {
+                requestSyncInterest();
+            }
+            if (initpubs != m_publications) {
+                handleInterests();
+            }
+        }
+
+        /**
+         * @brief deliver the publications in a sync Data
+         *
+         * Add each item in Data content that we don't have to
+         * our list of active publications then notify the
+         * application about the updates.
+         *
+         * @param overheard if given, 'data' answered another node's interest
+         *                  (see listenForReply): the hashes of the pubs it
+         *                  carries are added to this and its difference
+         *                  estimate, which is about that node's iblt, is
+         *                  ignored
+         * @return false if the Data's content isn't a syncpsContent block
+         */
+        bool deliverPubs(const ndn::Data &data, std::vector<uint32_t> *overheard = nullptr) {
+            const ndn::Block &pubs(data.getContent().blockFromValue());
+            if (pubs.type() != tlv::syncpsContent) {
+                NDN_LOG_WARN("Sync Data with wrong content type " <<
+                                                                  pubs.type() << " ignored.");
+                return false;
+            }
+
+            // if publications result from handling this data we don't want to
             // respond to a peer's interest until we've handled all of them.
             m_delivering = true;
-            auto initpubs = m_publications;
 
             pubs.parse();
             for (const auto &e : pubs.elements()) {
+                if (e.type() == tlv::syncpsDiffEstimate) {
+                    if (overheard == nullptr) {
+                        raiseLevel(ndn::encoding::readNonNegativeInteger(e));
+                    }
+                    continue;
+                }
                 if (e.type() != ndn::tlv::Data) {
                     NDN_LOG_WARN("Sync Data with wrong Publication type " <<
                                                                           e.type() << " ignored.");
                     continue;
                 }
+                // the pub's hash is over its wire encoding, which is exactly
+                // this element, so known pubs are skipped without decoding.
+                auto hash = murmurHash3(N_HASHCHECK, e.wire(), e.size());
+                if (overheard != nullptr) {
+                    overheard->push_back(hash);
+                }
+                if (isKnown(hash)) {
+                    continue;
+                }
                 //XXX validate pub against schema here
                 Publication pub(e);
-                if (m_isExpired(pub) || isKnown(pub)) {
-                    NDN_LOG_DEBUG("ignore expired or known " << pub.getName());
+                if (m_isExpired(pub)) {
+                    NDN_LOG_DEBUG("ignore expired " << pub.getName());
+                    continue;
+                }
+                if (outlivedTopic(pub)) {
+                    NDN_LOG_DEBUG("ignore " << pub.getName() << " past its topic lifetime");
+                    continue;
+                }
+                if (isSuperseded(pub)) {
+                    NDN_LOG_DEBUG("ignore superseded " << pub.getName());
                     continue;
                 }
                 // we don't already have this publication so deliver it
                 // to the longest match subscription.
-                // XXX lower_bound goes one too far when doing longest
-                // prefix match. It would be faster to stick a marker on
-                // the end of subscription entries so this wouldn't happen.
-                // Also, it would be faster to do the comparison on the
-                // wire-format names (excluding the leading length value)
-                // rather than default of component-by-component.
-                const auto &p = addToActive(std::move(pub));
+                const auto &p = addToActive(std::move(pub), hash);
                 const auto &nm = p->getName();
-                auto sub = m_subscription.lower_bound(nm);
-                if ((sub != m_subscription.end() && sub->first.isPrefixOf(nm)) ||
-                    (sub != m_subscription.begin() && (--sub)->first.isPrefixOf(nm))) {
-                    NDN_LOG_DEBUG("deliver " << nm << " to " << sub->first);
-                    sub->second(*p);
+                if (const auto sub = m_subscription.longestMatch(nm); sub != nullptr) {
+                    NDN_LOG_DEBUG("deliver " << nm << " to " << sub->prefix);
+                    for (const auto &cb : sub->values) {
+                        cb(*p);
+                    }
                 } else {
                     NDN_LOG_DEBUG("no sub for  " << nm);
                 }
             }
 
-            // We've delivered all the publications in the Data.
-            // If this is our currently active sync interest, send an
-            // interest to replace the one consumed by the Data.
-            // If deliveries resulted in new publications, try to satisfy
-            // pending peer interests.
             m_delivering = false;
-            if (interest.getNonce() == m_currentInterest) {
-                sendSyncInterest();
+            return true;
+        }
+
+        /**
+         * @brief start fetching the rest of a segmented reply
+         *
+         * @param data the reply to our current sync interest
+         * @return true if 'data' is segment 0 of a multi-segment reply
+         */
+        bool fetchSegments(const ndn::Data &data) {
+            const auto &name = data.getName();
+            const auto &last = data.getFinalBlock();
+            if (!name[-1].isSegment() || name[-1].toSegment() != 0 ||
+                !last || !last->isSegment() || last->toSegment() == 0) {
+                return false;
+            }
+            m_fetch.prefix = name.getPrefix(-1);
+            m_fetch.next = 1;
+            m_fetch.last = std::min<uint64_t>(last->toSegment(), maxReplySegments);
+            m_fetch.deliver = 1;
+            m_fetch.inFlight = 0;
+            m_fetch.nonce = m_currentInterest;
+            m_fetch.early.clear();
+            m_fetch.retry.clear();
+            m_fetch.losses.clear();
+            ++m_fetch.id;
+            NDN_LOG_DEBUG("fetchSegments " << m_fetch.prefix << " 1.." << m_fetch.last);
+            fillSegmentWindow();
+            return true;
+        }
+
+        /**
+         * @brief express segment interests until the window is full
+         *
+         * Lost segments are asked for again before new ones.
+         * m_segmentWindow is adjusted AIMD-style: it grows by about one
+         * segment per window delivered and halves on each timeout or nack.
+         * It's kept across fetches since it tracks how well replies reach us.
+         */
+        void fillSegmentWindow() {
+            while (m_fetch.inFlight < size_t(m_segmentWindow)) {
+                uint64_t seg;
+                if (!m_fetch.retry.empty()) {
+                    seg = m_fetch.retry.back();
+                    m_fetch.retry.pop_back();
+                } else if (m_fetch.next <= m_fetch.last) {
+                    seg = m_fetch.next++;
+                } else {
+                    break;
+                }
+                ndn::Interest interest(ndn::Name(m_fetch.prefix).appendSegment(seg));
+                interest.setCanBePrefix(false)
+                        .setMustBeFresh(true)
+                        .setInterestLifetime(segmentInterestLifetime);
+                ++m_fetch.inFlight;
+                auto id = m_fetch.id;
+                m_face.expressInterest(interest,
+                                       [this, id, seg](auto i, auto d) {
+                                           m_validator.validate(d,
+                                                                [this, id, seg](auto d) { onSegmentData(id, seg, d); },
+                                                                [this, id, seg](auto d, auto e) {
+                                                                    NDN_LOG_INFO("Invalid: " << e << " Data " << d);
+                                                                    onSegmentLost(id, seg);
+                                                                });
+                                       },
+                                       [this, id, seg](auto i, auto/*n*/) {
+                                           NDN_LOG_INFO("Nack for " << i);
+                                           onSegmentLost(id, seg);
+                                       },
+                                       [this, id, seg](auto i) {
+                                           NDN_LOG_INFO("Timeout for " << i);
+                                           onSegmentLost(id, seg);
+                                       });
             }
+        }
+
+        /**
+         * @brief a segment arrived: deliver it and any buffered ones after
+         *        it, in segment order
+         *
+         * A reply's pubs are packed in order, so delivering segments out
+         * of order could let a stream's summary (see setStreamKey) pass
+         * pubs in a segment that's still missing.
+         */
+        void onSegmentData(uint32_t id, uint64_t seg, const ndn::Data &data) {
+            NDN_LOG_DEBUG("onSegmentData: " << data.getName());
+            if (id != m_fetch.id) {
+                return;
+            }
+            m_segmentWindow = std::min(m_segmentWindow + 1.0 / m_segmentWindow,
+                                       double(maxReplySegments));
+            auto initpubs = m_publications;
+            if (seg <= m_fetch.last) {
+                m_fetch.early.emplace(seg, data);
+            }
+            for (auto e = m_fetch.early.begin();
+                 e != m_fetch.early.end() && e->first == m_fetch.deliver; ++m_fetch.deliver) {
+                deliverPubs(e->second);
+                e = m_fetch.early.erase(e);
+            }
+            segmentDone();
             if (initpubs != m_publications) {
                 handleInterests();
             }
         }
 
+        /**
+         * @brief a segment timed out, was nacked or was invalid: ask for it
+         *        again or, after segmentRetries, give up on it and the
+         *        segments after it (their pubs show up in the difference of
+         *        our next sync interest)
+         */
+        void onSegmentLost(uint32_t id, uint64_t seg) {
+            if (id != m_fetch.id) {
+                return;
+            }
+            m_segmentWindow = std::max(m_segmentWindow / 2, 1.0);
+            if (seg <= m_fetch.last) {
+                if (++m_fetch.losses[seg] <= segmentRetries) {
+                    m_fetch.retry.push_back(seg);
+                } else {
+                    NDN_LOG_INFO("giving up on " << m_fetch.prefix << " from segment " << seg);
+                    m_fetch.last = seg - 1;
+                    m_fetch.early.erase(m_fetch.early.lower_bound(seg), m_fetch.early.end());
+                    m_fetch.retry.erase(std::remove_if(m_fetch.retry.begin(), m_fetch.retry.end(),
+                                                       [seg](auto k) { return k > seg; }),
+                                        m_fetch.retry.end());
+                }
+            }
+            segmentDone();
+        }
+
+        /**
+         * @brief account for a segment that arrived or was given up on.
+         *
+         * When the last one is in, our deferred sync interest goes out
+         * (unless one was already sent for some other reason).
+         */
+        void segmentDone() {
+            --m_fetch.inFlight;
+            if (!m_fetch.retry.empty() || m_fetch.next <= m_fetch.last) {
+                fillSegmentWindow();
+            } else if (m_fetch.inFlight == 0 && m_fetch.nonce == m_currentInterest) {
+                requestSyncInterest();
+            }
+        }
+
         /**
          * @brief Methods to manage the active publication set.
          */
 
-        // publications are stored using a shared_ptr so we
-        // get to them indirectly via their hash.
+        // publications are stored in m_pubs keyed by their hash.
 
         uint32_t hashPub(const Publication &pub) const {
             const auto &b = pub.wireEncode();
-            return murmurHash3(N_HASHCHECK,
-                               std::vector<uint8_t>(b.wire(), b.wire() + b.size()));
+            return murmurHash3(N_HASHCHECK, b.wire(), b.size());
         }
 
         bool isKnown(uint32_t h) const {
-            //return m_hash2pub.contains(h);
-            return m_hash2pub.find(h) != m_hash2pub.end();
+            return m_pubs.contains(h);
         }
 
-        bool isKnown(const Publication &pub) const {
-            // publications are stored using a shared_ptr so we
-            // get to them indirectly via their hash.
-            return isKnown(hashPub(pub));
-        }
-
-        std::shared_ptr<Publication> addToActive(Publication &&pub, bool localPub = false) {
+        /**
+         * @brief add 'pub', whose hashPub is 'hash', to the active set
+         */
+        PubPtr addToActive(Publication &&pub, uint32_t hash, bool localPub = false) {
             NDN_LOG_DEBUG("addToActive: " << pub.getName());
-            auto hash = hashPub(pub);
-            auto p = std::make_shared<Publication>(pub);
-            m_active[p] = localPub ? 3 : 1;
-            m_hash2pub[hash] = p;
-            m_iblt.insert(hash);
-
-            // We remove an expired publication from our active set at twice its pub
-            // lifetime (the extra time is to prevent replay attacks enabled by clock
-            // skew).  An expired publication is never supplied in response to a sync
-            // interest so this extra hold time prevents end-of-lifetime spurious
-            // exchanges due to clock skew.
+            const auto &policy = topicPolicy(pub.getName());
+            auto expires = ndn::time::steady_clock::now() + policy.lifetime;
+            const auto timestamp = pubTimestamp(pub);
+            auto &e = m_pubs.insert(hash, std::move(pub),
+                                    PubStore::Active | (localPub ? PubStore::Local : 0),
+                                    timestamp, expires);
+            e.priority = policy.priority;
+            auto p = e.pub;
+            if (auto key = streamKey(*p)) {
+                addToStream(*key, hash);
+            } else {
+                updateIblt(1, hash);
+            }
+            if (policy.latestWins) {
+                makeLatest(p->getName(), hash, timestamp);
+            }
+
+            // We remove an expired publication from our active set at twice its
+            // topic's pub lifetime (see setTopicPolicy). The extra time is to
+            // prevent replay attacks enabled by clock skew. An expired publication
+            // is never supplied in response to a sync interest so this extra hold
+            // time prevents end-of-lifetime spurious exchanges due to clock skew.
             //
             // Expired publications are kept in the iblt for at least the max clock skew
             // interval to prevent a peer with a late clock giving it back to us as soon
             // as we delete it.
 
-            m_scheduler.schedule(maxPubLifetime, [this, p] { m_active[p] &= ~1U; });
-            m_scheduler.schedule(maxPubLifetime + maxClockSkew,
-                                 [this, hash] {
-                                     m_iblt.erase(hash);
-                                     sendSyncInterestSoon();
-                                 });
-            m_scheduler.schedule(maxPubLifetime * 2, [this, p] { removeFromActive(p); });
+            //
+            // The three steps are driven by m_pubTimers: each pub has one
+            // entry that moves on to the next step when it fires.
+
+            m_pubTimers.add(expires, PubTimer{hash, PubTimer::Deactivate});
+            startPubTimers();
 
             return p;
         }
 
-        void removeFromActive(const PubPtr &p) {
-            NDN_LOG_DEBUG("removeFromActive: " << (*p).getName());
-            m_active.erase(p);
-            m_hash2pub.erase(hashPub(*p));
+        const TopicPolicy &topicPolicy(const Name &name) const {
+            static const TopicPolicy defaultPolicy{};
+            if (m_policies.empty()) {
+                return defaultPolicy;
+            }
+            const auto p = m_policies.longestMatch(name);
+            return p != nullptr ? p->values.front() : defaultPolicy;
+        }
+
+        // the producer of a pub for latest-wins: its name up to the last
+        // timestamp (the whole name if there's none, so it replaces nothing)
+        static Name producerOf(const Name &name) {
+            for (auto i = name.size(); i-- > 0; ) {
+                if (name[i].isTimestamp()) {
+                    return name.getPrefix(i);
+                }
+            }
+            return name;
+        }
+
+        /**
+         * @brief true if 'pub' was made longer ago than its topic's lifetime
+         *        (plus clock skew) allows
+         *
+         * m_isExpired only knows about maxPubLifetime, and a pub of a topic
+         * with a shorter lifetime is removed long before that. Without this
+         * a peer that still has it could give it back to us once it's gone,
+         * and it would be delivered again.
+         */
+        bool outlivedTopic(const Publication &pub) const {
+            if (m_policies.empty()) {
+                return false;
+            }
+            const auto &policy = topicPolicy(pub.getName());
+            const auto timestamp = pubTimestamp(pub);
+            return policy.lifetime < maxPubLifetime &&
+                   timestamp != ndn::time::system_clock::TimePoint{} &&
+                   ndn::time::system_clock::now() - timestamp > policy.lifetime + maxClockSkew;
+        }
+
+        /**
+         * @brief true if 'pub' is under a latest-wins topic and older than
+         *        its producer's latest pub
+         */
+        bool isSuperseded(const Publication &pub) const {
+            if (m_latest.empty() || !topicPolicy(pub.getName()).latestWins) {
+                return false;
+            }
+            const auto l = m_latest.find(producerOf(pub.getName()));
+            return l != m_latest.end() && pubTimestamp(pub) < l->second.timestamp;
+        }
+
+        /**
+         * @brief note 'hash', a pub made at 'timestamp' that was just added,
+         *        as its producer's latest and retire the pubs it replaces
+         *        (or the pub itself if it's older than the latest)
+         */
+        void makeLatest(const Name &name, uint32_t hash,
+                        ndn::time::system_clock::TimePoint timestamp) {
+            auto &l = m_latest[producerOf(name)];
+            if (!l.hashes.empty() && timestamp < l.timestamp) {
+                retire(hash);
+                return;
+            }
+            if (l.hashes.empty() || timestamp > l.timestamp) {
+                for (const auto h : l.hashes) {
+                    retire(h);
+                }
+                l.hashes.clear();
+                l.timestamp = timestamp;
+            }
+            l.hashes.push_back(hash);
+        }
+
+        /**
+         * @brief take a superseded pub out of the iblt and active set
+         *
+         * It stays in m_pubs until its normal removal so a peer that still
+         * has it can't give it back to us. Stream pubs only go inactive:
+         * their stream's summary already stands for the newer one.
+         */
+        void retire(uint32_t hash) {
+            const auto e = m_pubs.find(hash);
+            if (e == nullptr || (e->flags & PubStore::Superseded) != 0) {
+                return;
+            }
+            NDN_LOG_DEBUG("superseded: " << e->pub->getName());
+            e->flags = (e->flags & ~PubStore::Active) | PubStore::Superseded;
+            ++m_activeEpoch;
+            if (!streamKey(*e->pub)) {
+                updateIblt(-1, hash);
+            }
+        }
+
+        // 'hash' is leaving the iblt: it's no longer its producer's latest
+        void forgetLatest(const Name &name, uint32_t hash) {
+            const auto l = m_latest.find(producerOf(name));
+            if (l == m_latest.end()) {
+                return;
+            }
+            auto &h = l->second.hashes;
+            h.erase(std::remove(h.begin(), h.end(), hash), h.end());
+            if (h.empty()) {
+                m_latest.erase(l);
+            }
+        }
+
+        void startPubTimers() {
+            if (!m_pubTimerId) {
+                m_pubTimerId = m_scheduler.schedule(pubTimerTick, [this] { onPubTimerTick(); });
+            }
+        }
+
+        /**
+         * @brief run the pub lifecycle steps that are due
+         *
+         * All the pubs erased from the iblt in one tick result in a
+         * single sync interest.
+         */
+        void onPubTimerTick() {
+            bool erased = false;
+            m_pubTimers.advance(ndn::time::steady_clock::now(), [this, &erased](PubTimer &t) {
+                auto e = m_pubs.find(t.hash);
+                if (e == nullptr) {
+                    return;
+                }
+                switch (t.step) {
+                    case PubTimer::Deactivate:
+                        e->flags &= ~PubStore::Active;
+                        ++m_activeEpoch;
+                        t.step = PubTimer::EraseFromIblt;
+                        m_pubTimers.add(e->expires + maxClockSkew, t);
+                        break;
+                    case PubTimer::EraseFromIblt: {
+                        const auto &policy = topicPolicy(e->pub->getName());
+                        if (auto key = streamKey(*e->pub)) {
+                            erased |= eraseStreamSummary(*key);
+                        } else if ((e->flags & PubStore::Superseded) == 0) {
+                            updateIblt(-1, t.hash);
+                            erased = true;
+                        }
+                        if (policy.latestWins && (e->flags & PubStore::Superseded) == 0) {
+                            forgetLatest(e->pub->getName(), t.hash);
+                        }
+                        t.step = PubTimer::Remove;
+                        m_pubTimers.add(e->expires + policy.lifetime, t);
+                        break;
+                    }
+                    case PubTimer::Remove:
+                        NDN_LOG_DEBUG("removeFromActive: " << e->pub->getName());
+                        if (auto key = streamKey(*e->pub)) {
+                            removeFromStream(*key, t.hash);
+                        }
+                        m_pubs.erase(t.hash);
+                        break;
+                }
+            });
+            if (erased) {
+                sendSyncInterestSoon();
+            }
+            if (!m_pubTimers.empty()) {
+                startPubTimers();
+            }
+        }
+
+        /**
+         * @brief Methods to manage stream summaries (see setStreamKey).
+         */
+
+        std::optional<StreamKey> streamKey(const Publication &pub) const {
+            return m_streamKey ? m_streamKey(pub) : std::nullopt;
+        }
+
+        // iblt entry of a stream when its latest pub is 'seq': the hash of
+        // its producer's name (Stream::producerHash, worked out once) chained
+        // with the two halves of 'seq', so nothing is encoded or allocated
+        static uint32_t hashStream(uint32_t producerHash, uint64_t seq) {
+            return murmurHash3(murmurHash3(producerHash, uint32_t(seq)), uint32_t(seq >> 32));
+        }
+
+        /**
+         * @brief add the pub with hash 'hash' to its stream, replacing the
+         *        stream's iblt entry if it's the newest
+         */
+        void addToStream(const StreamKey &key, uint32_t hash) {
+            auto [s, added] = m_streams.try_emplace(key.producer);
+            auto &st = s->second;
+            if (added) {
+                const auto &b = key.producer.wireEncode();
+                st.producerHash = murmurHash3(N_HASHCHECK, b.wire(), b.size());
+            }
+            if (!st.pubs.emplace(key.seq, hash).second) {
+                NDN_LOG_WARN("duplicate seq " << key.seq << " in stream " << key.producer);
+                return;
+            }
+            m_streamSeqs.emplace(hashStream(st.producerHash, key.seq), std::make_pair(s, key.seq));
+            if (!added && key.seq <= st.seq) {
+                return;
+            }
+            if (st.inIblt) {
+                updateIblt(-1, hashStream(st.producerHash, st.seq));
+            }
+            st.seq = key.seq;
+            st.inIblt = true;
+            updateIblt(1, hashStream(st.producerHash, key.seq));
+        }
+
+        /**
+         * @brief take a stream out of the iblt if 'key' is its newest pub
+         *
+         * @return true if the iblt changed
+         */
+        bool eraseStreamSummary(const StreamKey &key) {
+            auto s = m_streams.find(key.producer);
+            if (s == m_streams.end() || !s->second.inIblt || s->second.seq != key.seq) {
+                return false;
+            }
+            updateIblt(-1, hashStream(s->second.producerHash, key.seq));
+            s->second.inIblt = false;
+            return true;
+        }
+
+        void removeFromStream(const StreamKey &key, uint32_t hash) {
+            auto s = m_streams.find(key.producer);
+            if (s == m_streams.end()) {
+                return;
+            }
+            auto &pubs = s->second.pubs;
+            if (auto p = pubs.find(key.seq); p != pubs.end() && p->second == hash) {
+                pubs.erase(p);
+                m_streamSeqs.erase(hashStream(s->second.producerHash, key.seq));
+            }
+            if (pubs.empty() && !s->second.inIblt) {
+                m_streams.erase(s);
+            }
+        }
+
+        /**
+         * @brief insert (+1) or erase (-1) 'hash' in our iblt
+         *
+         * Changes are logged while there are pending interests so their
+         * saved differences can be updated instead of re-decoded. Pubs
+         * can keep changing the iblt while none of those interests can be
+         * answered, so the log is applied and cleared once it reaches
+         * maxIbltLog entries.
+         */
+        void updateIblt(int plusOrMinus, uint32_t hash) {
+            if (!updateLevels(m_iblts, plusOrMinus, hash)) {
+                return;
+            }
+            if (m_interests.empty()) {
+                m_ibltLog.clear();
+                m_ibltLogBase = ibltVersion();
+            } else {
+                m_ibltLog.emplace_back(plusOrMinus, hash);
+                if (m_ibltLog.size() >= maxIbltLog) {
+                    catchUpInterests();
+                }
+            }
         }
 
         /**
@@ -565,8 +2206,18 @@ namespace syncps {
 
         uint32_t hashIBLT(const Name &n) const {
             const auto &b = n[-1];
-            return murmurHash3(N_HASHCHECK,
-                               std::vector<uint8_t>(b.value_begin(), b.value_end()));
+            return murmurHash3(N_HASHCHECK, b.value(), b.value_size());
+        }
+
+        ReplyKey replyKey(const Name &n) const {
+            return {hashIBLT64(n), ibltVersion(), m_activeEpoch};
+        }
+
+        // wider hash of the iblt component, used as the pending interest key
+        uint64_t hashIBLT64(const Name &n) const {
+            const auto &b = n[-1];
+            return (uint64_t(murmurHash3(N_HASHCHECK, b.value(), b.value_size())) << 32) |
+                   murmurHash3(N_HASHCHECK + 1, b.value(), b.value_size());
         }
 
     private:
@@ -575,23 +2226,132 @@ namespace syncps {
         uint32_t m_expectedNumEntries;
         ndn::security::v2::Validator &m_validator;
         ndn::Scheduler m_scheduler;
-        std::map<const Name, ndn::time::system_clock::TimePoint> m_interests{};
-        IBLT m_iblt;
+        // a peer's sync interest that we couldn't answer yet
+        struct PendingInterest {
+            Name name;
+            ndn::time::system_clock::TimePoint expires;
+            IBLT diff;          // our iblt minus theirs ...
+            uint64_t version;   // ... as of this ibltVersion()
+        };
+        // pending interests by hashIBLT64 of their name, and a min-heap of
+        // their expiration times
+        std::unordered_map<uint64_t, PendingInterest> m_interests{};
+        // sync states of peers we couldn't answer, by hashIBLT64 of their
+        // interest name (see setPeerPush)
+        struct RecentPeer {
+            size_t level{};     // of ours that 'iblt' is the size of
+            IBLT iblt{0};
+            ndn::time::steady_clock::TimePoint seen{};
+            ndn::time::steady_clock::TimePoint pushed{};
+        };
+        std::unordered_map<uint64_t, RecentPeer> m_recentPeers{};
+        ndn::time::milliseconds m_peerPushInterval{0};
+        PeelBuffers m_pushPeeled;       // reused by each notifyPeers
+        // replies being held back, by hashIBLT64 of the interest name (see
+        // setReplySuppression)
+        struct DelayedReply {
+            Name name;
+            ReplyPlan plan;
+            ReplyData cached;   // the signed reply to resend, if any
+            ReplyKey key;       // it goes in m_replyCache under ...
+            bool shrunk{false}; // ... unless overheard replies trimmed it
+            ndn::scheduler::ScopedEventId timer;
+            std::vector<ndn::ScopedPendingInterestHandle> listens;
+        };
+        std::unordered_map<uint64_t, DelayedReply> m_delayedReplies{};
+        // signed replies by what they were made from. Pubs going inactive
+        // bump m_activeEpoch since that changes what we'd send without
+        // changing the iblt.
+        LruCache<ReplyKey, CachedReply, ReplyKeyHash> m_replyCache{replyCacheSize};
+        uint64_t m_activeEpoch{0};
+        ndn::time::milliseconds m_replyDelay{0};
+        using InterestExpiry = std::pair<ndn::time::system_clock::TimePoint, uint64_t>;
+        std::priority_queue<InterestExpiry, std::vector<InterestExpiry>,
+                            std::greater<InterestExpiry>> m_interestExpiry{};
+        // m_ibltLog[i] took the iblts from version m_ibltLogBase + i to the next one
+        std::vector<std::pair<int, uint32_t>> m_ibltLog{};
+        uint64_t m_ibltLogBase{0};
+        std::vector<IBLT> m_iblts;     // levels, smallest first
+        size_t m_level{0};              // the one our sync interests carry
+        unsigned m_levelHold{0};        // interests left before m_level drops
+        PeelBuffers m_peeled;           // reused by each handleInterest
+        IBLTEncoding m_ibltEncoding{IBLTEncoding::Legacy};
+        // encoding of m_iblts[m_ibltComponentLevel] as of
+        // ibltVersion() == m_ibltComponentVersion
+        ndn::name::Component m_ibltComponent;
+        uint64_t m_ibltComponentVersion{std::numeric_limits<uint64_t>::max()};
+        size_t m_ibltComponentLevel{0};
+        uint32_t m_ibltHash{};
         ndn::KeyChain m_keyChain;
         SigningInfo m_signingInfo;
         // currently active published items
-        std::unordered_map<std::shared_ptr<const Publication>, uint8_t> m_active{};
-        std::unordered_map<uint32_t, std::shared_ptr<const Publication>> m_hash2pub{};
-        std::map<const Name, UpdateCb> m_subscription{};
+        PubStore m_pubs;
+        NameTrie<UpdateCb> m_subscription{};
+        NameTrie<TopicPolicy> m_policies{};     // one value per topic
+        // the newest pubs of each producer under a latest-wins topic that
+        // are still in the iblt
+        struct Latest {
+            ndn::time::system_clock::TimePoint timestamp;
+            std::vector<uint32_t> hashes;   // pubs in m_pubs made at 'timestamp'
+        };
+        std::map<Name, Latest> m_latest{};
+        // per-producer streams when syncing stream summaries
+        struct Stream {
+            uint64_t seq{};                 // newest pub's
+            bool inIblt{false};             // hashStream(producerHash, seq) is in the iblt
+            uint32_t producerHash{};        // of the producer's name
+            std::map<uint64_t, uint32_t> pubs{};    // seq -> hash of the pub in m_pubs
+        };
+        using Streams = std::map<Name, Stream>;
+        StreamKeyCb m_streamKey{};
+        Streams m_streams{};
+        // what the stream's summary was as of each of its pubs, by hashStream
+        std::unordered_map<uint32_t, std::pair<Streams::iterator, uint64_t>> m_streamSeqs{};
+        // lifecycle of an active publication (see addToActive)
+        struct PubTimer {
+            enum Step : uint8_t { Deactivate, EraseFromIblt, Remove };
+            uint32_t hash;      // of the pub in m_pubs
+            Step step;
+        };
+        TimerWheel<PubTimer, ndn::time::steady_clock> m_pubTimers{
+                pubTimerTick, pubTimerSlots, ndn::time::steady_clock::now()};
+        ndn::scheduler::ScopedEventId m_pubTimerId;
+        // segmented replies we sent, by hashIBLT64 of the interest name
+        struct ReplySegments {
+            ndn::time::system_clock::TimePoint expires;
+            ReplyData segments;
+        };
+        std::unordered_map<uint64_t, ReplySegments> m_replySegments{};
+        size_t m_maxReplySegments{1};
+        // the segmented reply we're fetching
+        struct SegmentFetch {
+            ndn::Name prefix;   // reply name without the segment number
+            uint64_t next;      // next segment to request
+            uint64_t last;      // final segment (lowered when one is given up on)
+            uint64_t deliver;   // next segment to deliver
+            size_t inFlight;    // segment interests outstanding
+            uint32_t nonce;     // of the sync interest the reply answered
+            uint32_t id;        // fetch generation (ignore stale callbacks)
+            std::map<uint64_t, ndn::Data> early;        // arrived ahead of 'deliver'
+            std::vector<uint64_t> retry;                // lost, to be asked for again
+            std::map<uint64_t, unsigned> losses;        // times each was lost
+        };
+        SegmentFetch m_fetch{};
+        double m_segmentWindow{2};
         IsExpiredCb m_isExpired;
         FilterPubsCb m_filterPubs;
         ndn::time::milliseconds m_syncInterestLifetime;
         ndn::scheduler::ScopedEventId m_scheduledSyncInterestId;
+        ndn::time::steady_clock::TimePoint m_nextSyncInterest{};   // when it fires
+        ndn::time::steady_clock::TimePoint m_nextNeedInterest{};   // earliest pullNeeded send
+        SyncRateControl m_rateControl{};
+        using TxBucket = TokenBucket<ndn::time::steady_clock>;
+        TxBucket m_txBucket{};
+        SyncStats m_stats{};
         //ndn::ScopedPendingInterestHandle m_interest;
         ndn::ScopedRegisteredPrefixHandle m_registeredPrefix;
         uint32_t m_currentInterest{};   // nonce of current sync interest
         uint32_t m_publications{};      // # local publications
-        uint32_t m_interestsSent{};
         bool m_delivering{false};       // currently processing a Data
         bool m_registering{true};
     };
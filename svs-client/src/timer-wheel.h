@@ -0,0 +1,112 @@
+/*
+ * Hashed timer wheel for coarse, high-volume timeouts (see syncps.h).
+ *
+ * Time is divided into ticks of a fixed duration and each entry lands in
+ * slot (expiry tick % #slots). Entries further out than one turn of the
+ * wheel share a slot with nearer ones and are simply skipped until their
+ * tick comes up. Adding is O(1) and advancing costs O(#ticks passed +
+ * #entries in the slots visited), with no per-entry allocation beyond the
+ * slot vectors' amortized growth.
+ */
+
+#ifndef SYNCPS_TIMER_WHEEL_HPP
+#define SYNCPS_TIMER_WHEEL_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace syncps {
+
+    template<typename T, typename Clock = std::chrono::steady_clock>
+    class TimerWheel {
+    public:
+        using TimePoint = typename Clock::time_point;
+        using Duration = typename Clock::duration;
+
+        /**
+         * @brief constructor
+         *
+         * @param tick  timer resolution; entries fire on the first advance()
+         *              at or after the end of the tick containing their time
+         * @param slots number of slots (a few more than the longest usual
+         *              timeout / tick keeps each slot down to one tick's worth)
+         * @param start time the wheel starts at
+         */
+        TimerWheel(Duration tick, size_t slots, TimePoint start)
+                : m_tick(tick), m_slots(std::max<size_t>(slots, 1)),
+                  m_current(tickOf(start)) {}
+
+        /**
+         * @brief add 'item' to fire at time 'when' (times in the past fire
+         *        on the next tick)
+         */
+        void add(TimePoint when, T item) {
+            auto t = std::max(tickOf(when) + 1, m_current + 1);
+            m_slots[t % m_slots.size()].push_back({t, std::move(item)});
+            ++m_size;
+        }
+
+        /**
+         * @brief fire every entry that's due as of 'now'
+         *
+         * 'fire' is called once per entry after the wheel has moved to
+         * 'now', so it may add new entries.
+         *
+         * @return number of entries fired
+         */
+        template<typename F>
+        size_t advance(TimePoint now, F&& fire) {
+            auto target = tickOf(now);
+            if (target <= m_current) {
+                return 0;
+            }
+            auto last = std::min(target, m_current + m_slots.size());
+            for (auto t = m_current + 1; t <= last; t++) {
+                auto& slot = m_slots[t % m_slots.size()];
+                size_t n = 0;
+                for (auto& e : slot) {
+                    if (e.first <= target) {
+                        m_due.push_back(std::move(e.second));
+                    } else {
+                        slot[n++] = std::move(e);
+                    }
+                }
+                slot.resize(n);
+            }
+            m_current = target;
+            m_size -= m_due.size();
+            auto due = std::move(m_due);
+            m_due.clear();
+            for (auto& item : due) {
+                fire(item);
+            }
+            auto fired = due.size();
+            due.clear();
+            m_due = std::move(due);     // keep the capacity
+            return fired;
+        }
+
+        size_t size() const { return m_size; }
+
+        bool empty() const { return m_size == 0; }
+
+        Duration tick() const { return m_tick; }
+
+    private:
+        uint64_t tickOf(TimePoint t) const {
+            return uint64_t(t.time_since_epoch() / m_tick);
+        }
+
+        Duration m_tick;
+        std::vector<std::vector<std::pair<uint64_t, T>>> m_slots;
+        std::vector<T> m_due;
+        uint64_t m_current;     // last tick processed
+        size_t m_size{0};
+    };
+
+}  // namespace syncps
+
+#endif  // SYNCPS_TIMER_WHEEL_HPP
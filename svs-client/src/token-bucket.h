@@ -0,0 +1,92 @@
+/*
+ * Byte-rate token bucket (see syncps.h).
+ *
+ * Tokens (bytes) accrue at 'rate' per second up to 'depth'. A send is
+ * allowed whenever the bucket isn't in debt and then takes its full size,
+ * possibly going into debt, so packets larger than the depth still go out
+ * and the long term rate is still bounded by 'rate'.
+ */
+
+#ifndef SYNCPS_TOKEN_BUCKET_HPP
+#define SYNCPS_TOKEN_BUCKET_HPP
+
+#include <algorithm>
+#include <chrono>
+
+namespace syncps {
+
+    template<typename Clock = std::chrono::steady_clock>
+    class TokenBucket {
+    public:
+        using TimePoint = typename Clock::time_point;
+        using Duration = typename Clock::duration;
+
+        /**
+         * @brief an unlimited bucket
+         */
+        TokenBucket() = default;
+
+        /**
+         * @brief constructor
+         *
+         * @param rate  bytes per second (0 means unlimited)
+         * @param depth max bytes that can be sent in a burst
+         */
+        TokenBucket(double rate, double depth)
+                : m_rate(rate), m_depth(depth), m_tokens(depth) {}
+
+        bool limited() const { return m_rate > 0; }
+
+        /**
+         * @brief true if a send is allowed at 'now'
+         */
+        bool ready(TimePoint now) {
+            refill(now);
+            return !limited() || m_tokens > 0;
+        }
+
+        /**
+         * @brief account for sending 'bytes' at 'now'
+         */
+        void consume(double bytes, TimePoint now) {
+            if (limited()) {
+                refill(now);
+                m_tokens -= bytes;
+            }
+        }
+
+        /**
+         * @brief how long after 'now' until a send is allowed
+         */
+        Duration wait(TimePoint now) {
+            if (ready(now)) {
+                return Duration::zero();
+            }
+            auto ticks = (1 - m_tokens) / m_rate / seconds(Duration(1));
+            return Duration(typename Duration::rep(ticks) + 1);
+        }
+
+    private:
+        // 'd' in seconds. Done on Duration's own ratio so it works with
+        // any chrono-like clock (std::chrono or ndn-cxx's boost::chrono).
+        static double seconds(Duration d) {
+            return double(d.count()) * Duration::period::num / Duration::period::den;
+        }
+
+        void refill(TimePoint now) {
+            if (m_last != TimePoint{}) {
+                auto dt = seconds(now - m_last);
+                m_tokens = std::min(m_depth, m_tokens + dt * m_rate);
+            }
+            m_last = now;
+        }
+
+        double m_rate{0};
+        double m_depth{0};
+        double m_tokens{0};
+        TimePoint m_last{};
+    };
+
+}  // namespace syncps
+
+#endif  // SYNCPS_TOKEN_BUCKET_HPP
@@ -78,4 +78,263 @@ TEST_CASE("Find IBLT Limit")
             }
         }
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("murmurHash3 overloads agree")
+{
+    GIVEN("Random keys and byte strings")
+    {
+        THEN("The uint32_t fast path matches hashing the key's bytes") {
+            for (int i = 0; i < 1000; i++) {
+                uint32_t key = std::rand();
+                std::vector<unsigned char> bytes((unsigned char*)&key,
+                                                 (unsigned char*)&key + sizeof(key));
+                REQUIRE(syncps::murmurHash3(syncps::N_HASHCHECK, key) ==
+                        syncps::murmurHash3(syncps::N_HASHCHECK, bytes));
+            }
+        }
+
+        THEN("Hashing an unaligned byte span matches hashing a copy of it") {
+            std::vector<unsigned char> buf(64);
+            for (auto& b : buf) {
+                b = std::rand();
+            }
+            for (size_t off = 0; off < 4; off++) {
+                for (size_t len = 0; len < buf.size() - off; len++) {
+                    std::vector<unsigned char> copy(buf.begin() + off, buf.begin() + off + len);
+                    REQUIRE(syncps::murmurHash3(7, buf.data() + off, len) ==
+                            syncps::murmurHash3(7, copy));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("IBLT kernels")
+{
+    GIVEN("Random cell arrays of various lengths")
+    {
+        THEN("Vector and scalar kernels agree") {
+            for (size_t n : {0, 1, 7, 8, 9, 31, 129, 1000}) {
+                std::vector<int32_t> a(n), b(n);
+                std::vector<uint32_t> x(n), y(n);
+                for (size_t i = 0; i < n; i++) {
+                    a[i] = std::rand() % 5 - 2;
+                    b[i] = std::rand() % 5 - 2;
+                    x[i] = std::rand();
+                    y[i] = std::rand();
+                }
+                auto a1 = a;
+                auto x1 = x;
+                syncps::simd::sub(a.data(), b.data(), n);
+                syncps::simd::subScalar(a1.data(), b.data(), n);
+                REQUIRE(a == a1);
+                syncps::simd::xorInto(x.data(), y.data(), n);
+                syncps::simd::xorScalar(x1.data(), y.data(), n);
+                REQUIRE(x == x1);
+
+                std::vector<uint32_t> c, c1;
+                syncps::simd::findUnitCounts(a.data(), n, c);
+                syncps::simd::findUnitCountsScalar(a.data(), n, c1);
+                REQUIRE(c == c1);
+            }
+        }
+    }
+
+    GIVEN("Two IBLTs with a small difference")
+    {
+        syncps::IBLT ours(85), theirs(85);
+        std::set<uint32_t> onlyOurs, onlyTheirs;
+        for (int i = 0; i < 60; i++) {
+            uint32_t key = std::rand();
+            ours.insert(key);
+            theirs.insert(key);
+        }
+        for (int i = 0; i < 10; i++) {
+            uint32_t key = std::rand();
+            ours.insert(key);
+            onlyOurs.insert(key);
+            key = std::rand();
+            theirs.insert(key);
+            onlyTheirs.insert(key);
+        }
+
+        THEN("Peeling the difference recovers both sides") {
+            std::set<uint32_t> positive, negative;
+            REQUIRE((ours - theirs).listEntries(positive, negative));
+            REQUIRE(positive == onlyOurs);
+            REQUIRE(negative == onlyTheirs);
+        }
+
+        THEN("Peeling in place into reused buffers gives the same result") {
+            syncps::PeelBuffers peeled;
+            for (int round = 0; round < 2; round++) {
+                auto diff = ours - theirs;
+                REQUIRE(diff.peel(peeled));
+                REQUIRE(std::set<uint32_t>(peeled.positive.begin(), peeled.positive.end()) == onlyOurs);
+                REQUIRE(std::set<uint32_t>(peeled.negative.begin(), peeled.negative.end()) == onlyTheirs);
+                REQUIRE(diff == syncps::IBLT(85));
+            }
+        }
+
+        THEN("Listing into reused buffers leaves the table unchanged") {
+            syncps::PeelBuffers peeled;
+            const auto diff = ours - theirs;
+            for (int round = 0; round < 2; round++) {
+                REQUIRE(diff.listEntries(peeled));
+                REQUIRE(peeled.complete);
+                REQUIRE(std::set<uint32_t>(peeled.positive.begin(), peeled.positive.end()) == onlyOurs);
+                REQUIRE(std::set<uint32_t>(peeled.negative.begin(), peeled.negative.end()) == onlyTheirs);
+                REQUIRE(diff == ours - theirs);
+            }
+        }
+    }
+}
+
+TEST_CASE("IBLT wire encodings")
+{
+    GIVEN("A partially filled IBLT and a difference with negative counts")
+    {
+        syncps::IBLT iblt(85), other(85);
+        for (int i = 0; i < 40; i++) {
+            iblt.insert(std::rand());
+            other.insert(std::rand());
+        }
+        auto diff = iblt - other;
+
+        THEN("Every encoding round-trips") {
+            for (auto enc : {syncps::IBLTEncoding::Legacy, syncps::IBLTEncoding::Compact,
+                             syncps::IBLTEncoding::CompactZlib}) {
+                for (const auto* table : {&iblt, &diff}) {
+                    ndn::Name name("/ndn/");
+                    table->appendToName(name, enc);
+                    syncps::IBLT parsed(85);
+                    REQUIRE_NOTHROW(parsed.initialize(name.get(-1)));
+                    REQUIRE(parsed == *table);
+                }
+            }
+        }
+
+        THEN("Only inserts and erases change the table version") {
+            auto v = iblt.version();
+            iblt.toComponent();
+            auto copy = iblt - other;
+            REQUIRE(iblt.version() == v);
+            iblt.insert(42);
+            REQUIRE(iblt.version() == v + 1);
+            iblt.erase(42);
+            REQUIRE(iblt.version() == v + 2);
+        }
+
+        THEN("The compact encoding is smaller than the legacy one") {
+            REQUIRE(iblt.toComponent(syncps::IBLTEncoding::Compact).value_size() <
+                    iblt.toComponent(syncps::IBLTEncoding::Legacy).value_size());
+            REQUIRE(syncps::IBLT(85).toComponent(syncps::IBLTEncoding::Compact).value_size() < 4);
+        }
+
+        THEN("The default encoding is the legacy one") {
+            REQUIRE(iblt.toComponent() == iblt.toComponent(syncps::IBLTEncoding::Legacy));
+        }
+
+        THEN("Malformed compact encodings are rejected") {
+            auto c = iblt.toComponent(syncps::IBLTEncoding::Compact);
+            syncps::IBLT wrongSize(200), parsed(85);
+            REQUIRE_THROWS_AS(wrongSize.initialize(c), syncps::IBLT::Error);
+            ndn::name::Component truncated(c.value(), c.value_size() - 3);
+            REQUIRE_THROWS_AS(parsed.initialize(truncated), syncps::IBLT::Error);
+        }
+
+        THEN("A zlib encoding that inflates past the largest table is rejected") {
+            // a MAX_CELLS table header followed by 2MB of (compressible) zeros
+            std::vector<char> raw(2 << 20, 0);
+            raw[0] = char(0x80);
+            raw[1] = char(0x80);
+            raw[2] = 0x04;
+            std::vector<char> bomb{0x02};
+            boost::iostreams::filtering_streambuf<boost::iostreams::input> in;
+            in.push(boost::iostreams::zlib_compressor());
+            in.push(boost::iostreams::array_source(raw.data(), raw.size()));
+            boost::iostreams::copy(in, boost::iostreams::back_inserter(bomb));
+            REQUIRE(bomb.size() < 8800);
+            syncps::IBLT parsed(0);
+            REQUIRE_THROWS_WITH(parsed.decode(ndn::name::Component((const uint8_t*)bomb.data(), bomb.size())),
+                                Catch::Contains("too big"));
+        }
+    }
+}
+
+TEST_CASE("IBLT levels")
+{
+    GIVEN("Tables of several sizes")
+    {
+        THEN("decode takes the table size from the encoding") {
+            for (size_t n : {85, 340, 1360}) {
+                syncps::IBLT iblt(n);
+                for (int i = 0; i < 50; i++) {
+                    iblt.insert(std::rand());
+                }
+                for (auto enc : {syncps::IBLTEncoding::Compact, syncps::IBLTEncoding::CompactZlib}) {
+                    syncps::IBLT parsed(0);
+                    REQUIRE_NOTHROW(parsed.decode(iblt.toComponent(enc)));
+                    REQUIRE(parsed == iblt);
+                }
+            }
+        }
+
+        THEN("The occupancy estimate tracks the number of entries past the peeling limit") {
+            for (size_t d : {0, 20, 50, 250}) {
+                syncps::IBLT iblt(85);
+                for (size_t i = 0; i < d; i++) {
+                    iblt.insert(std::rand());
+                }
+                auto est = iblt.estimateEntries();
+                if (d > 150) {
+                    // almost no empty cells left: only 'too many' is reliable
+                    REQUIRE(est > 100);
+                    continue;
+                }
+                REQUIRE(est >= d / 2);
+                REQUIRE(est <= d * 2 + 1);
+            }
+        }
+
+        THEN("An erase is applied to every level or to none") {
+            std::vector<syncps::IBLT> levels{syncps::IBLT(85), syncps::IBLT(340), syncps::IBLT(1360)};
+            std::vector<uint32_t> keys;
+            for (int i = 0; i < 60; i++) {
+                keys.push_back(std::rand());
+                REQUIRE(syncps::updateLevels(levels, 1, keys.back()));
+            }
+            const auto before = levels;
+
+            // a key no level holds
+            uint32_t stranger = std::rand();
+            while (std::find(keys.begin(), keys.end(), stranger) != keys.end()) {
+                stranger = std::rand();
+            }
+            REQUIRE_FALSE(syncps::updateLevels(levels, -1, stranger));
+            REQUIRE(levels == before);
+
+            // one the smallest level would erase but the biggest rejects
+            uint32_t mixed = std::rand();
+            while (levels[0].badPeers(mixed) || !levels[2].badPeers(mixed)) {
+                mixed = std::rand();
+            }
+            REQUIRE_FALSE(syncps::updateLevels(levels, -1, mixed));
+            REQUIRE(levels == before);
+            for (size_t l = 0; l < levels.size(); l++) {
+                REQUIRE(levels[l].version() == before[l].version());
+            }
+
+            REQUIRE(syncps::updateLevels(levels, -1, keys[0]));
+            for (size_t l = 0; l < levels.size(); l++) {
+                REQUIRE(levels[l].version() == before[l].version() + 1);
+            }
+        }
+
+        THEN("Subtracting tables of different sizes throws") {
+            syncps::IBLT a(85), b(340);
+            REQUIRE_THROWS_AS(a - b, syncps::IBLT::Error);
+        }
+    }
+}
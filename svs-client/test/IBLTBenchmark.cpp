@@ -0,0 +1,168 @@
+//
+// Microbenchmarks for the IBLT hot paths (run with ./IBLTBenchmark).
+//
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+
+#include <catch2/catch.hpp>
+#include <cstdlib>
+
+#include "../src/iblt.h"
+
+TEST_CASE("IBLT cell kernels")
+{
+    for (size_t n = 128; n <= 64 * 1024; n *= 2) {
+        std::vector<int32_t> a(n), b(n);
+        std::vector<uint32_t> x(n), y(n);
+        for (size_t i = 0; i < n; i++) {
+            a[i] = std::rand() % 7 - 3;
+            b[i] = std::rand() % 7 - 3;
+            x[i] = std::rand();
+            y[i] = std::rand();
+        }
+        std::vector<uint32_t> out;
+        out.reserve(n);
+        auto cells = std::to_string(n);
+
+        // each run subtracts from fresh copies of the same cells (the
+        // kernels work in place), as operator- does with its result
+        std::vector<int32_t> count(n);
+        std::vector<uint32_t> keySum(n), keyCheck(n);
+        BENCHMARK("subtract scalar, " + cells + " cells") {
+            count = a;
+            keySum = x;
+            keyCheck = x;
+            syncps::simd::subScalar(count.data(), b.data(), n);
+            syncps::simd::xorScalar(keySum.data(), y.data(), n);
+            syncps::simd::xorScalar(keyCheck.data(), y.data(), n);
+            return count[0];
+        };
+        BENCHMARK("subtract simd, " + cells + " cells") {
+            count = a;
+            keySum = x;
+            keyCheck = x;
+            syncps::simd::sub(count.data(), b.data(), n);
+            syncps::simd::xorInto(keySum.data(), y.data(), n);
+            syncps::simd::xorInto(keyCheck.data(), y.data(), n);
+            return count[0];
+        };
+        BENCHMARK("pure candidates scalar, " + cells + " cells") {
+            out.clear();
+            syncps::simd::findUnitCountsScalar(a.data(), n, out);
+            return out.size();
+        };
+        BENCHMARK("pure candidates simd, " + cells + " cells") {
+            out.clear();
+            syncps::simd::findUnitCounts(a.data(), n, out);
+            return out.size();
+        };
+    }
+}
+
+TEST_CASE("IBLT subtraction")
+{
+    // n cells <=> n * 2 / 3 expected entries (see IBLT constructor)
+    for (size_t n = 128; n <= 64 * 1024; n *= 2) {
+        syncps::IBLT ours(n * 2 / 3), theirs(n * 2 / 3);
+        for (size_t i = 0; i < n / 2; i++) {
+            ours.insert(std::rand());
+            theirs.insert(std::rand());
+        }
+        BENCHMARK("IBLT operator-, " + std::to_string(ours.size()) + " cells") {
+            return ours - theirs;
+        };
+    }
+}
+
+// the peeler listEntries used before the worklist one: copy the table
+// and rescan every cell until a pass peels nothing
+static bool listEntriesRescan(const syncps::IBLT& iblt, std::set<uint32_t>& positive,
+                              std::set<uint32_t>& negative)
+{
+    syncps::IBLT peeled = iblt;
+    bool peeledSomething;
+    do {
+        peeledSomething = false;
+        for (size_t i = 0; i < peeled.size(); i++) {
+            const auto entry = peeled.cell(i);
+            if (entry.isPure()) {
+                if (peeled.badPeers(entry.keySum)) {
+                    return false;
+                }
+                (entry.count == 1 ? positive : negative).insert(entry.keySum);
+                peeled.apply(-entry.count, entry.keySum);
+                peeledSomething = true;
+            }
+        }
+    } while (peeledSomething);
+    return true;
+}
+
+TEST_CASE("IBLT peeling")
+{
+    // decoding cost should follow the difference size, not the table size
+    for (size_t n = 128; n <= 64 * 1024; n *= 8) {
+        syncps::IBLT ours(n * 2 / 3), theirs(n * 2 / 3);
+        for (size_t i = 0; i < n / 2; i++) {
+            uint32_t key = std::rand();
+            ours.insert(key);
+            theirs.insert(key);
+        }
+        for (size_t i = 0; i < 20; i++) {
+            ours.insert(std::rand());
+            theirs.insert(std::rand());
+        }
+        auto diff = ours - theirs;
+        syncps::PeelBuffers peeled;
+        std::set<uint32_t> refPositive, refNegative, positive, negative;
+        REQUIRE(listEntriesRescan(diff, refPositive, refNegative));
+        REQUIRE(diff.listEntries(positive, negative));
+        REQUIRE(positive == refPositive);
+        REQUIRE(negative == refNegative);
+
+        BENCHMARK("rescan (old listEntries), 40 keys, " + std::to_string(diff.size()) + " cells") {
+            std::set<uint32_t> positive, negative;
+            listEntriesRescan(diff, positive, negative);
+            return positive.size();
+        };
+        BENCHMARK("listEntries into std::set, 40 keys, " + std::to_string(diff.size()) + " cells") {
+            std::set<uint32_t> positive, negative;
+            diff.listEntries(positive, negative);
+            return positive.size();
+        };
+        BENCHMARK("listEntries into PeelBuffers, 40 keys, " + std::to_string(diff.size()) + " cells") {
+            diff.listEntries(peeled);
+            return peeled.positive.size();
+        };
+    }
+}
+
+TEST_CASE("IBLT wire encodings")
+{
+    const std::pair<syncps::IBLTEncoding, const char*> encodings[] = {
+            {syncps::IBLTEncoding::Legacy,      "legacy"},
+            {syncps::IBLTEncoding::Compact,     "compact"},
+            {syncps::IBLTEncoding::CompactZlib, "compact+zlib"}};
+
+    for (size_t nKeys : {0, 10, 40, 85}) {
+        syncps::IBLT iblt(85);
+        for (size_t i = 0; i < nKeys; i++) {
+            iblt.insert(std::rand());
+        }
+        for (const auto& [enc, label] : encodings) {
+            auto c = iblt.toComponent(enc);
+            std::cout << label << ", " << nKeys << " keys: " << std::dec
+                      << c.value_size() << " bytes" << std::endl;
+            auto what = std::string(label) + ", " + std::to_string(nKeys) + " keys";
+
+            BENCHMARK("encode " + what) {
+                return iblt.toComponent(enc);
+            };
+            BENCHMARK("decode " + what) {
+                syncps::IBLT parsed(85);
+                parsed.initialize(c);
+                return parsed.size();
+            };
+        }
+    }
+}
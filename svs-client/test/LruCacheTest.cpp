@@ -0,0 +1,61 @@
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+#include <string>
+
+#include "../src/lru-cache.h"
+
+using Cache = syncps::LruCache<int, std::string>;
+
+TEST_CASE("LruCache")
+{
+    GIVEN("A full cache of 3 entries")
+    {
+        Cache cache(3);
+        cache.insert(1, "one");
+        cache.insert(2, "two");
+        cache.insert(3, "three");
+        REQUIRE(cache.size() == 3);
+
+        THEN("Inserting drops the least recently used entry") {
+            cache.insert(4, "four");
+            REQUIRE(cache.size() == 3);
+            REQUIRE(cache.find(1) == nullptr);
+            REQUIRE(*cache.find(4) == "four");
+        }
+
+        THEN("Finding an entry makes it the most recently used") {
+            REQUIRE(*cache.find(1) == "one");
+            cache.insert(4, "four");
+            REQUIRE(cache.find(2) == nullptr);
+            REQUIRE(cache.find(1) != nullptr);
+            REQUIRE(cache.find(3) != nullptr);
+        }
+
+        THEN("Inserting a key it has replaces its value without dropping any") {
+            cache.insert(1, "uno");
+            REQUIRE(cache.size() == 3);
+            REQUIRE(*cache.find(1) == "uno");
+            cache.insert(4, "four");
+            REQUIRE(cache.find(2) == nullptr);
+            REQUIRE(cache.find(1) != nullptr);
+        }
+
+        THEN("Clearing empties it") {
+            cache.clear();
+            REQUIRE(cache.size() == 0);
+            REQUIRE(cache.find(1) == nullptr);
+        }
+    }
+
+    GIVEN("A cache of no entries")
+    {
+        Cache cache(0);
+
+        THEN("Nothing is kept") {
+            cache.insert(1, "one");
+            REQUIRE(cache.size() == 0);
+            REQUIRE(cache.find(1) == nullptr);
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+#include <vector>
+
+#include <ndn-cxx/name.hpp>
+
+#include "../src/name-trie.h"
+
+using Trie = syncps::NameTrie<int>;
+
+static int matchOf(const Trie& trie, const char* name) {
+    const auto e = trie.longestMatch(ndn::Name(name));
+    return e == nullptr ? -1 : e->values.front();
+}
+
+TEST_CASE("NameTrie")
+{
+    GIVEN("Topics with and without wildcards")
+    {
+        Trie trie;
+        trie["/position"].values.push_back(1);
+        trie["/position/*/p1"].values.push_back(2);
+        trie["/position/ndn/p1"].values.push_back(3);
+        trie["/position/*/*/unit"].values.push_back(4);
+        REQUIRE(trie.size() == 4);
+
+        THEN("The longest matching prefix wins") {
+            REQUIRE(matchOf(trie, "/position") == 1);
+            REQUIRE(matchOf(trie, "/position/ndn") == 1);
+            REQUIRE(matchOf(trie, "/position/ndn/p1/unit3/t") == 3);
+            REQUIRE(matchOf(trie, "/voice/ndn/p1") == -1);
+            REQUIRE(trie.longestMatch(ndn::Name("/position"))->prefix == ndn::Name("/position"));
+        }
+
+        THEN("A wildcard matches any one component") {
+            REQUIRE(matchOf(trie, "/position/edu/p1") == 2);
+            REQUIRE(matchOf(trie, "/position/edu/p2") == 1);
+            REQUIRE(matchOf(trie, "/position/edu/p2/unit") == 4);
+        }
+
+        THEN("A longer wildcard match beats a shorter exact one") {
+            REQUIRE(matchOf(trie, "/position/ndn/p1/unit") == 4);
+        }
+
+        THEN("Several values can share a topic") {
+            trie["/position/*/p1"].values.push_back(5);
+            REQUIRE(trie.size() == 4);
+            const auto e = trie.longestMatch(ndn::Name("/position/edu/p1"));
+            REQUIRE(e->values == std::vector<int>{2, 5});
+        }
+
+        THEN("Erasing a topic falls back to the next longest one") {
+            REQUIRE(trie.erase(ndn::Name("/position/*/p1")));
+            REQUIRE_FALSE(trie.erase(ndn::Name("/position/*/p1")));
+            REQUIRE(trie.size() == 3);
+            REQUIRE(matchOf(trie, "/position/edu/p1") == 1);
+            REQUIRE(matchOf(trie, "/position/ndn/p1") == 3);
+            REQUIRE(matchOf(trie, "/position/edu/p2/unit") == 4);
+        }
+
+        THEN("Erasing a prefix keeps the topics below it") {
+            REQUIRE(trie.erase(ndn::Name("/position")));
+            REQUIRE(matchOf(trie, "/position/ndn") == -1);
+            REQUIRE(matchOf(trie, "/position/edu/p1") == 2);
+        }
+    }
+}
@@ -0,0 +1,125 @@
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+#include <cstdlib>
+#include <set>
+
+#include <ndn-cxx/data.hpp>
+
+#include "../src/pub-store.h"
+
+static syncps::PubStore::Entry& add(syncps::PubStore& store, uint32_t hash) {
+    ndn::Name name("/pub");
+    name.appendNumber(hash);
+    return store.insert(hash, ndn::Data(name), syncps::PubStore::Active,
+                        ndn::time::system_clock::now(), ndn::time::steady_clock::now());
+}
+
+static bool holds(const syncps::PubStore& store, uint32_t hash) {
+    const auto e = store.find(hash);
+    return e != nullptr && e->hash == hash && e->pub->getName().get(-1).toNumber() == hash;
+}
+
+TEST_CASE("PubStore")
+{
+    GIVEN("A store of 16 slots with a run of colliding hashes")
+    {
+        syncps::PubStore store(16);
+        // 5, 21 and 37 all start probing at slot 5; 6 is pushed past them
+        for (uint32_t h : {5, 21, 6, 37}) {
+            add(store, h);
+        }
+        REQUIRE(store.size() == 4);
+
+        THEN("Erasing from the middle of the run keeps the rest reachable") {
+            store.erase(21);
+            REQUIRE(store.size() == 3);
+            REQUIRE_FALSE(store.contains(21));
+            for (uint32_t h : {5, 6, 37}) {
+                REQUIRE(holds(store, h));
+            }
+            // the run shifted back: no tombstone is left where 21 was
+            add(store, 53);
+            for (uint32_t h : {5, 6, 37, 53}) {
+                REQUIRE(holds(store, h));
+            }
+        }
+
+        THEN("Erasing the head of the run moves its successors home") {
+            store.erase(5);
+            store.erase(37);
+            REQUIRE(holds(store, 21));
+            REQUIRE(holds(store, 6));
+            store.erase(21);
+            REQUIRE(holds(store, 6));
+            REQUIRE(store.size() == 1);
+        }
+
+        THEN("Erasing an absent hash changes nothing") {
+            store.erase(69);
+            REQUIRE(store.size() == 4);
+        }
+    }
+
+    GIVEN("A run that wraps around the end of the table")
+    {
+        syncps::PubStore store(16);
+        // homes 15, 15, 0: they occupy slots 15, 0 and 1
+        for (uint32_t h : {15, 31, 16}) {
+            add(store, h);
+        }
+
+        THEN("Backward shifts cross the wrap") {
+            store.erase(15);
+            REQUIRE(holds(store, 31));
+            REQUIRE(holds(store, 16));
+            store.erase(31);
+            REQUIRE(holds(store, 16));
+        }
+    }
+
+    GIVEN("Many random pubs")
+    {
+        syncps::PubStore store;
+        std::set<uint32_t> hashes;
+        while (hashes.size() < 2000) {
+            hashes.insert(std::rand());
+        }
+        for (auto h : hashes) {
+            add(store, h);
+        }
+
+        THEN("They survive growth and interleaved erases") {
+            REQUIRE(store.size() == hashes.size());
+            size_t i = 0;
+            for (auto h = hashes.begin(); h != hashes.end(); i++) {
+                if (i % 2 == 0) {
+                    store.erase(*h);
+                    h = hashes.erase(h);
+                } else {
+                    ++h;
+                }
+            }
+            REQUIRE(store.size() == hashes.size());
+            for (auto h : hashes) {
+                REQUIRE(holds(store, h));
+            }
+            size_t n = 0;
+            store.forEach([&n](const auto&) { n++; });
+            REQUIRE(n == hashes.size());
+        }
+    }
+
+    GIVEN("A pub held outside the store")
+    {
+        syncps::PubStore::PubPtr pub;
+        {
+            syncps::PubStore store;
+            pub = add(store, 42).pub;
+        }
+
+        THEN("It outlives the store") {
+            REQUIRE(pub->getName().get(-1).toNumber() == 42);
+        }
+    }
+}
@@ -0,0 +1,908 @@
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ndn-cxx/security/key-chain.hpp>
+#include <ndn-cxx/util/dummy-client-face.hpp>
+#include <ndn-cxx/util/random.hpp>
+#include <ndn-cxx/util/time-custom-clock.hpp>
+
+#include "../src/partitioned-syncps.h"
+
+using namespace syncps;
+
+// a clock that only moves when the test moves it
+template<typename BaseClock>
+class ManualClock : public ndn::time::CustomClock<BaseClock> {
+public:
+    explicit ManualClock(typename BaseClock::time_point start) : m_now(start) {}
+
+    typename BaseClock::time_point getNow() const override { return m_now; }
+
+    std::string getSince() const override { return " since the test started"; }
+
+    typename BaseClock::duration toWaitDuration(typename BaseClock::duration) const override {
+        return typename BaseClock::duration(1);
+    }
+
+    void advance(ndn::time::nanoseconds d) { m_now += d; }
+
+private:
+    typename BaseClock::time_point m_now;
+};
+
+// SyncPubsub nodes on DummyClientFaces sharing one io_service and clock
+class SyncFixture {
+public:
+    SyncFixture()
+            : m_steadyClock(std::make_shared<ManualClock<ndn::time::steady_clock>>(
+                      ndn::time::steady_clock::time_point(1000_s))),
+              m_systemClock(std::make_shared<ManualClock<ndn::time::system_clock>>(
+                      ndn::time::system_clock::time_point(1600000000_s))) {
+        ndn::time::setCustomClocks(m_steadyClock, m_systemClock);
+    }
+
+    ~SyncFixture() {
+        ndn::time::setCustomClocks(nullptr, nullptr);
+    }
+
+    /**
+     * @brief move the clocks 'nTicks' times by 'tick', running whatever
+     *        is due after each
+     */
+    void advanceClocks(ndn::time::nanoseconds tick, size_t nTicks = 1) {
+        for (size_t i = 0; i < nTicks; i++) {
+            m_steadyClock->advance(tick);
+            m_systemClock->advance(tick);
+            if (io.stopped()) {
+                io.restart();
+            }
+            io.poll();
+        }
+    }
+
+private:
+    std::shared_ptr<ManualClock<ndn::time::steady_clock>> m_steadyClock;
+    std::shared_ptr<ManualClock<ndn::time::system_clock>> m_systemClock;
+
+public:
+    boost::asio::io_service io;
+    ndn::KeyChain keyChain{"pib-memory:", "tpm-memory:"};
+};
+
+// a node that takes every pub and, while 'replies' is set, sends peers
+// everything they lack (ours first)
+class Node {
+public:
+    Node(boost::asio::io_service &io, ndn::KeyChain &keyChain,
+         IsExpiredCb isExpired = [](const auto &) { return false; })
+            : face(io, keyChain, {true, true}),
+              sync(face, "/sync", std::move(isExpired),
+                   [this](auto &ours, auto &others) {
+                       if (!replies) {
+                           return VPubPtr{};
+                       }
+                       ours.insert(ours.end(), others.begin(), others.end());
+                       return ours;
+                   },
+                   1_s) {
+        sync.subscribeTo(Name(), [this](const auto &pub) { got.push_back(pub.getName()); });
+    }
+
+    /**
+     * @brief the sync Data this node sent under 'name'
+     */
+    std::vector<ndn::Data> sentUnder(const Name &name) const {
+        std::vector<ndn::Data> data;
+        for (const auto &d : face.sentData) {
+            if (name.isPrefixOf(d.getName())) {
+                data.push_back(d);
+            }
+        }
+        return data;
+    }
+
+    ndn::util::DummyClientFace face;
+    bool replies{true};
+    SyncPubsub sync;
+    std::vector<Name> got;
+};
+
+// a publication named 'name' + <timestamp of now> with 'size' bytes of content
+static Publication makePub(const Name &name, size_t size = 100) {
+    Publication pub(Name(name).appendTimestamp());
+    std::vector<uint8_t> content(size, 'x');
+    pub.setContent(content.data(), content.size());
+    return pub;
+}
+
+// a peer's sync interest for the state in 'iblt'
+static ndn::Interest peerInterest(const IBLT &iblt = IBLT(85)) {
+    ndn::Interest interest(Name("/sync").append(iblt.toComponent()));
+    interest.setNonce(ndn::random::generateWord32())
+            .setCanBePrefix(true)
+            .setMustBeFresh(true)
+            .setInterestLifetime(1_s);
+    return interest;
+}
+
+// what a sync reply carries
+struct Reply {
+    std::vector<Name> pubs;
+    uint64_t estimate{0};
+};
+
+static Reply parseReply(const ndn::Data &data) {
+    Reply reply;
+    const auto content = data.getContent().blockFromValue();
+    REQUIRE(content.type() == syncps::tlv::syncpsContent);
+    content.parse();
+    for (const auto &e : content.elements()) {
+        if (e.type() == syncps::tlv::syncpsDiffEstimate) {
+            reply.estimate = ndn::encoding::readNonNegativeInteger(e);
+        } else if (e.type() == ndn::tlv::Data) {
+            reply.pubs.push_back(ndn::Data(e).getName());
+        }
+    }
+    return reply;
+}
+
+TEST_CASE_METHOD(SyncFixture, "Pending sync interests")
+{
+    GIVEN("A node with nothing to send")
+    {
+        Node a(io, keyChain);
+        advanceClocks(10_ms);
+        const auto interest = peerInterest();
+        a.face.receive(interest);
+        advanceClocks(10_ms);
+        REQUIRE(a.sentUnder(interest.getName()).empty());
+
+        THEN("A later publish answers the waiting interest") {
+            auto pub = makePub("/position/a");
+            const auto name = pub.getName();
+            a.sync.publish(std::move(pub));
+            advanceClocks(10_ms);
+            const auto replies = a.sentUnder(interest.getName());
+            REQUIRE(replies.size() == 1);
+            REQUIRE(parseReply(replies[0]).pubs == std::vector<Name>{name});
+        }
+
+        THEN("Interests from peers in different states each get their own reply") {
+            IBLT other(85);
+            other.insert(42);
+            const auto second = peerInterest(other);
+            a.face.receive(second);
+            advanceClocks(10_ms);
+            auto pub = makePub("/position/a");
+            const auto name = pub.getName();
+            a.sync.publish(std::move(pub));
+            advanceClocks(10_ms);
+            for (const auto &i : {interest, second}) {
+                const auto replies = a.sentUnder(i.getName());
+                REQUIRE(replies.size() == 1);
+                REQUIRE(replies[0].getName() == i.getName());
+                REQUIRE(parseReply(replies[0]).pubs == std::vector<Name>{name});
+            }
+        }
+
+        THEN("The saved difference follows pubs added while it can't be answered") {
+            a.replies = false;
+            auto p1 = makePub("/position/a");
+            const auto n1 = p1.getName();
+            a.sync.publish(std::move(p1));
+            advanceClocks(10_ms);
+            REQUIRE(a.sentUnder(interest.getName()).empty());
+
+            a.replies = true;
+            auto p2 = makePub("/position/b");
+            const auto n2 = p2.getName();
+            a.sync.publish(std::move(p2));
+            advanceClocks(10_ms);
+            const auto replies = a.sentUnder(interest.getName());
+            REQUIRE(replies.size() == 1);
+            auto pubs = parseReply(replies[0]).pubs;
+            std::sort(pubs.begin(), pubs.end());
+            REQUIRE(pubs == std::vector<Name>{n1, n2});
+        }
+
+        THEN("A re-expressed interest is answered once") {
+            for (int i = 0; i < 3; i++) {
+                a.face.receive(peerInterest());
+                advanceClocks(10_ms);
+            }
+            a.sync.publish(makePub("/position/a"));
+            advanceClocks(10_ms);
+            a.sync.publish(makePub("/position/b"));
+            advanceClocks(10_ms);
+            REQUIRE(a.sentUnder(interest.getName()).size() == 1);
+        }
+
+        THEN("A refreshed interest is kept until its latest expiry") {
+            // enough refreshes for the expiry heap to be compacted, then
+            // wait past the expiry of all but the last one
+            for (int i = 0; i < 30; i++) {
+                a.face.receive(peerInterest());
+                advanceClocks(30_ms);
+            }
+            advanceClocks(100_ms, 9);
+            a.sync.publish(makePub("/position/a"));
+            advanceClocks(10_ms);
+            REQUIRE(a.sentUnder(interest.getName()).size() == 1);
+        }
+
+        THEN("An expired interest isn't answered") {
+            advanceClocks(100_ms, 11);
+            a.sync.publish(makePub("/position/a"));
+            advanceClocks(10_ms);
+            REQUIRE(a.sentUnder(interest.getName()).empty());
+        }
+    }
+}
+
+TEST_CASE_METHOD(SyncFixture, "Sync reply packing")
+{
+    GIVEN("A node publishing pubs 1ms apart")
+    {
+        Node a(io, keyChain);
+        advanceClocks(10_ms);
+        std::vector<Name> names;    // oldest first
+        auto publish = [&](const char *name, size_t size) {
+            auto pub = makePub(name, size);
+            names.push_back(pub.getName());
+            a.sync.publish(std::move(pub));
+            advanceClocks(1_ms);
+        };
+
+        THEN("A reply takes the newest pubs, in order, until it's full") {
+            for (auto name : {"/p/0", "/p/1", "/p/2", "/p/3", "/p/4"}) {
+                publish(name, 500);
+            }
+            const auto interest = peerInterest();
+            a.face.receive(interest);
+            advanceClocks(10_ms);
+            const auto replies = a.sentUnder(interest.getName());
+            REQUIRE(replies.size() == 1);
+            REQUIRE(parseReply(replies[0]).pubs == std::vector<Name>{names[4], names[3], names[2]});
+        }
+
+        THEN("A pub that overflows a segment isn't skipped for the smaller ones after it") {
+            a.sync.setMaxReplySegments(4);
+            publish("/p/0", 100);
+            publish("/p/1", 100);
+            publish("/p/2", 2000);
+            publish("/p/3", 100);
+            const auto interest = peerInterest();
+            a.face.receive(interest);
+            advanceClocks(10_ms);
+            for (uint64_t seg = 1; seg < 4; seg++) {
+                ndn::Interest fetch(Name(interest.getName()).appendSegment(seg));
+                fetch.setMustBeFresh(true);
+                a.face.receive(fetch);
+            }
+            advanceClocks(10_ms);
+            const auto segments = a.sentUnder(interest.getName());
+            REQUIRE(segments.size() == 2);
+            REQUIRE(parseReply(segments[0]).pubs == std::vector<Name>{names[3], names[2]});
+            REQUIRE(parseReply(segments[1]).pubs == std::vector<Name>{names[1], names[0]});
+        }
+    }
+}
+
+TEST_CASE_METHOD(SyncFixture, "Segmented sync replies")
+{
+    GIVEN("A node with more pubs than fit in one Data")
+    {
+        Node a(io, keyChain);
+        a.sync.setMaxReplySegments(8);
+        advanceClocks(10_ms);
+        std::vector<Name> names;    // oldest first
+        for (int i = 0; i < 12; i++) {
+            auto pub = makePub(Name("/p").appendNumber(i), 500);
+            names.push_back(pub.getName());
+            a.sync.publish(std::move(pub));
+            advanceClocks(1_ms);
+        }
+        Node b(io, keyChain);
+        auto isSegment = [](const Name &name) { return name.size() == 3 && name[-1].isSegment(); };
+
+        THEN("A linked peer gets them all from one reply") {
+            b.face.linkTo(a.face);
+            advanceClocks(10_ms, 10);
+            auto got = b.got;
+            std::sort(got.begin(), got.end());
+            std::sort(names.begin(), names.end());
+            REQUIRE(got == names);
+            const auto &sent = b.face.sentInterests;
+            REQUIRE(std::count_if(sent.begin(), sent.end(),
+                                  [&](const auto &i) { return isSegment(i.getName()); }) >= 3);
+        }
+
+        THEN("A lost segment is asked for again and the segments are delivered in order") {
+            // carry b's sync and segment interests to a, except those 'drop'
+            // picks, and a's replies back to b
+            size_t nInterests = 0, nData = 0;
+            auto relay = [&](const std::function<bool(const Name &)> &drop) {
+                const auto &interests = b.face.sentInterests;
+                for (; nInterests < interests.size(); nInterests++) {
+                    const auto &i = interests[nInterests];
+                    if (Name("/sync").isPrefixOf(i.getName()) && !drop(i.getName())) {
+                        a.face.receive(i);
+                    }
+                }
+                advanceClocks(1_ms);
+                for (; nData < a.face.sentData.size(); nData++) {
+                    b.face.receive(a.face.sentData[nData]);
+                }
+                advanceClocks(1_ms);
+            };
+            auto none = [](const Name &) { return false; };
+
+            advanceClocks(10_ms);
+            relay(none);
+            const auto first = b.got.size();
+            REQUIRE(first > 0);
+            REQUIRE(first < names.size());
+            // segments 1 and 2 are asked for; 1 is lost
+            relay([&](const Name &name) { return isSegment(name) && name[-1].toSegment() == 1; });
+            REQUIRE(b.got.size() == first);
+
+            advanceClocks(100_ms, 6);
+            for (int i = 0; i < 10; i++) {
+                relay(none);
+            }
+            REQUIRE(b.got == std::vector<Name>(names.rbegin(), names.rend()));
+            // it all came in the one reply, with segment 1 asked for twice
+            const auto &sent = b.face.sentInterests;
+            const auto syncName = std::find_if(sent.begin(), sent.end(), [](const auto &i) {
+                return Name("/sync").isPrefixOf(i.getName());
+            })->getName();
+            for (const auto &d : a.face.sentData) {
+                REQUIRE(syncName.isPrefixOf(d.getName()));
+            }
+            REQUIRE(std::count_if(sent.begin(), sent.end(), [&](const auto &i) {
+                return i.getName() == Name(syncName).appendSegment(1);
+            }) == 2);
+        }
+    }
+}
+
+TEST_CASE_METHOD(SyncFixture, "Partitioned sync")
+{
+    GIVEN("A node in two partitions linked to a node in one of them")
+    {
+        auto never = [](const auto &) { return false; };
+        auto sendAll = [](auto &ours, auto &others) {
+            ours.insert(ours.end(), others.begin(), others.end());
+            return ours;
+        };
+        ndn::util::DummyClientFace faceA(io, keyChain, {true, true});
+        ndn::util::DummyClientFace faceB(io, keyChain, {true, true});
+        faceA.linkTo(faceB);
+        PartitionedSyncPubsub a(faceA, "/sync", never, sendAll, 1_s);
+        PartitionedSyncPubsub b(faceB, "/sync", never, sendAll, 1_s);
+        a.join("/position/p0");
+        a.join("/position/p1");
+        std::vector<Name> got;
+        b.subscribeTo("/position/p0", [&got](const auto &pub) { got.push_back(pub.getName()); });
+        REQUIRE(b.partitions() == std::vector<Name>{"/position/p0"});
+        advanceClocks(10_ms);
+
+        THEN("The peer only syncs and gets its own partition") {
+            std::vector<Name> p0;
+            for (int i = 0; i < 3; i++) {
+                auto pub = makePub("/position/p0/unit");
+                p0.push_back(pub.getName());
+                a.publish(std::move(pub));
+                a.publish(makePub("/position/p1/unit"));
+                advanceClocks(1_ms);
+            }
+            advanceClocks(10_ms, 10);
+            std::sort(got.begin(), got.end());
+            REQUIRE(got == p0);
+            for (const auto &i : faceB.sentInterests) {
+                if (Name("/sync").isPrefixOf(i.getName())) {
+                    REQUIRE(Name("/sync/position/p0").isPrefixOf(i.getName()));
+                }
+            }
+        }
+
+        THEN("Publishing outside the joined partitions throws") {
+            REQUIRE_THROWS_AS(b.publish(makePub("/position/p1/unit")), PartitionedSyncPubsub::Error);
+            std::vector<Publication> batch;
+            batch.push_back(makePub("/position/p0/unit"));
+            batch.push_back(makePub("/position/p2/unit"));
+            REQUIRE_THROWS_AS(a.publishBatch(std::move(batch)), PartitionedSyncPubsub::Error);
+            advanceClocks(10_ms, 10);
+            REQUIRE(got.empty());
+        }
+
+        THEN("Partitions can't be nested") {
+            REQUIRE_THROWS_AS(a.join("/position"), PartitionedSyncPubsub::Error);
+            REQUIRE_THROWS_AS(a.join("/position/p0/unit"), PartitionedSyncPubsub::Error);
+        }
+    }
+}
+
+TEST_CASE_METHOD(SyncFixture, "Stream sync")
+{
+    GIVEN("Two linked nodes syncing per-producer streams")
+    {
+        Node a(io, keyChain);
+        Node b(io, keyChain);
+        a.sync.setStreamKey(timestampStreamKey);
+        b.sync.setStreamKey(timestampStreamKey);
+        a.face.linkTo(b.face);
+        advanceClocks(10_ms);
+
+        THEN("Each producer's pubs arrive in the order they were published") {
+            std::vector<Name> u1, u2;
+            for (int i = 0; i < 10; i++) {
+                auto p1 = makePub("/position/u1", 500);
+                u1.push_back(p1.getName());
+                a.sync.publish(std::move(p1));
+                advanceClocks(1_ms);
+                auto p2 = makePub("/position/u2", 500);
+                u2.push_back(p2.getName());
+                a.sync.publish(std::move(p2));
+                advanceClocks(1_ms);
+            }
+            advanceClocks(10_ms, 20);
+            REQUIRE(b.got.size() == 20);
+            std::vector<Name> got1, got2;
+            for (const auto &name : b.got) {
+                (Name("/position/u1").isPrefixOf(name) ? got1 : got2).push_back(name);
+            }
+            REQUIRE(got1 == u1);
+            REQUIRE(got2 == u2);
+        }
+
+        THEN("A late joiner catches up on a stream oldest first") {
+            a.face.unlink();
+            std::vector<Name> u1;
+            for (int i = 0; i < 20; i++) {
+                auto pub = makePub("/position/u1", 500);
+                u1.push_back(pub.getName());
+                a.sync.publish(std::move(pub));
+                advanceClocks(1_ms);
+            }
+            // b's next sync interest (within a lifetime) finds a
+            a.face.linkTo(b.face);
+            advanceClocks(100_ms, 20);
+            REQUIRE(b.got == u1);
+        }
+    }
+}
+
+TEST_CASE_METHOD(SyncFixture, "Topic policies")
+{
+    GIVEN("Two nodes with latest-wins positions that live 10s")
+    {
+        Node a(io, keyChain);
+        Node b(io, keyChain);
+        for (auto node : {&a, &b}) {
+            node->sync.setTopicPolicy("/position", {10_s, 1, true});
+        }
+        advanceClocks(10_ms);
+
+        // a signed reply to b's current sync interest carrying 'pubs'
+        auto replyToB = [&](std::vector<Publication> &pubs) {
+            const auto &sent = b.face.sentInterests;
+            const auto interest = std::find_if(sent.rbegin(), sent.rend(), [](const auto &i) {
+                return Name("/sync").isPrefixOf(i.getName());
+            });
+            REQUIRE(interest != sent.rend());
+            const ndn::security::SigningInfo sha256(ndn::security::SigningInfo::SIGNER_TYPE_SHA256);
+            ndn::Block content(syncps::tlv::syncpsContent);
+            for (auto &pub : pubs) {
+                keyChain.sign(pub, sha256);
+                content.push_back(pub.wireEncode());
+            }
+            content.encode();
+            ndn::Data reply(interest->getName());
+            reply.setContent(content);
+            keyChain.sign(reply, sha256);
+            b.face.receive(reply);
+            advanceClocks(10_ms);
+        };
+
+        THEN("A peer only gets a unit's latest position") {
+            Name latest;
+            for (int i = 0; i < 3; i++) {
+                auto pub = makePub("/position/u1");
+                latest = pub.getName();
+                a.sync.publish(std::move(pub));
+                advanceClocks(1_ms);
+            }
+            a.face.linkTo(b.face);
+            advanceClocks(100_ms, 20);
+            REQUIRE(b.got == std::vector<Name>{latest});
+        }
+
+        THEN("A position older than the one it has is ignored") {
+            std::vector<Publication> pubs;
+            pubs.push_back(makePub("/position/u1"));
+            advanceClocks(1_ms);
+            pubs.insert(pubs.begin(), makePub("/position/u1"));
+            const auto newer = pubs[0].getName();
+            replyToB(pubs);
+            REQUIRE(b.got == std::vector<Name>{newer});
+        }
+
+        THEN("A position older than the topic lifetime is ignored") {
+            std::vector<Publication> pubs;
+            pubs.emplace_back(Name("/position/u1").appendTimestamp(
+                    ndn::time::system_clock::now() - 15_s));
+            pubs.push_back(makePub("/position/u2"));
+            const auto fresh = pubs[1].getName();
+            replyToB(pubs);
+            REQUIRE(b.got == std::vector<Name>{fresh});
+        }
+    }
+}
+
+TEST_CASE_METHOD(SyncFixture, "Reply cache")
+{
+    GIVEN("A node that answered a peer's sync interest")
+    {
+        Node a(io, keyChain);
+        advanceClocks(10_ms);
+        a.sync.publish(makePub("/position/a"));
+        advanceClocks(10_ms);
+        const auto interest = peerInterest();
+        a.face.receive(interest);
+        advanceClocks(10_ms);
+        REQUIRE(a.sentUnder(interest.getName()).size() == 1);
+        REQUIRE(a.sync.getStats().repliesCached == 0);
+
+        THEN("A repeat of the interest gets the same Data from the cache") {
+            a.face.receive(peerInterest());
+            advanceClocks(10_ms);
+            const auto replies = a.sentUnder(interest.getName());
+            REQUIRE(replies.size() == 2);
+            REQUIRE(replies[1].wireEncode() == replies[0].wireEncode());
+            REQUIRE(a.sync.getStats().repliesCached == 1);
+        }
+
+        THEN("Once its state changes the cached reply isn't used") {
+            auto pub = makePub("/position/b");
+            const auto name = pub.getName();
+            a.sync.publish(std::move(pub));
+            advanceClocks(10_ms);
+            a.face.receive(peerInterest());
+            advanceClocks(10_ms);
+            const auto replies = a.sentUnder(interest.getName());
+            REQUIRE(replies.size() == 2);
+            REQUIRE(parseReply(replies[1]).pubs.front() == name);
+            REQUIRE(a.sync.getStats().repliesCached == 0);
+        }
+
+        THEN("A repeat from a peer with a pub we lack pulls it again") {
+            IBLT theirs(85);
+            theirs.insert(42);
+            a.face.receive(peerInterest(theirs));
+            advanceClocks(10_ms);
+            REQUIRE(a.sync.getStats().needInterests == 1);
+            advanceClocks(needInterestInterval);
+            a.face.receive(peerInterest(theirs));
+            advanceClocks(10_ms);
+            REQUIRE(a.sync.getStats().repliesCached == 1);
+            REQUIRE(a.sync.getStats().needInterests == 2);
+        }
+
+        THEN("With replies held back a repeat is held back too") {
+            a.sync.setReplySuppression(1_s);
+            a.face.receive(peerInterest());
+            advanceClocks(1_us);
+            REQUIRE(a.sync.getStats().repliesDelayed == 1);
+            REQUIRE(a.sentUnder(interest.getName()).size() == 1);
+            advanceClocks(100_ms, 11);
+            const auto replies = a.sentUnder(interest.getName());
+            REQUIRE(replies.size() == 2);
+            REQUIRE(replies[1].wireEncode() == replies[0].wireEncode());
+            REQUIRE(a.sync.getStats().repliesCached == 1);
+        }
+    }
+}
+
+TEST_CASE_METHOD(SyncFixture, "Batched publish")
+{
+    GIVEN("A node with a peer's interest pending")
+    {
+        Node a(io, keyChain);
+        advanceClocks(10_ms);
+        const auto interest = peerInterest();
+        a.face.receive(interest);
+        advanceClocks(10_ms);
+        const auto sent = a.sync.getStats().interestsSent;
+
+        THEN("A batch of pubs goes out in one sync interest and one reply") {
+            std::vector<Publication> batch;
+            for (int i = 0; i < 5; i++) {
+                batch.push_back(makePub(Name("/voice/a").appendNumber(i)));
+            }
+            a.sync.publishBatch(std::move(batch));
+            advanceClocks(10_ms);
+            REQUIRE(a.sync.getStats().interestsSent == sent + 1);
+            const auto replies = a.sentUnder(interest.getName());
+            REQUIRE(replies.size() == 1);
+            REQUIRE(parseReply(replies[0]).pubs.size() == 5);
+        }
+
+        THEN("Publishing them one by one sends an interest for each") {
+            for (int i = 0; i < 5; i++) {
+                a.sync.publish(makePub(Name("/voice/a").appendNumber(i)));
+            }
+            advanceClocks(10_ms);
+            REQUIRE(a.sync.getStats().interestsSent == sent + 5);
+        }
+    }
+}
+
+TEST_CASE_METHOD(SyncFixture, "Sync interest rate control")
+{
+    GIVEN("A node that coalesces sync interests over 50ms")
+    {
+        Node a(io, keyChain);
+        a.sync.setRateControl({50_ms});
+        advanceClocks(10_ms);
+        REQUIRE(a.sync.getStats().interestsSent == 1);
+
+        THEN("A burst of publishes goes out in one sync interest") {
+            for (int i = 0; i < 5; i++) {
+                a.sync.publish(makePub(Name("/position/a").appendNumber(i)));
+                advanceClocks(1_ms);
+            }
+            REQUIRE(a.sync.getStats().interestsSent == 1);
+            REQUIRE(a.sync.getStats().interestsCoalesced == 4);
+            advanceClocks(10_ms, 5);
+            REQUIRE(a.sync.getStats().interestsSent == 2);
+        }
+    }
+
+    GIVEN("A node whose byte rate limit is used up by its first sync interest")
+    {
+        Node a(io, keyChain);
+        a.sync.setRateControl({0_ms, 0_ms, 1000, 1});
+        advanceClocks(10_ms);
+        REQUIRE(a.sync.getStats().interestsSent == 1);
+
+        THEN("The next sync interest waits for the bucket") {
+            a.sync.publish(makePub("/position/a"));
+            advanceClocks(1_ms);
+            REQUIRE(a.sync.getStats().interestsSent == 1);
+            REQUIRE(a.sync.getStats().interestsDelayed == 1);
+            advanceClocks(10_ms, 50);
+            REQUIRE(a.sync.getStats().interestsSent == 2);
+        }
+    }
+}
+
+TEST_CASE_METHOD(SyncFixture, "IBLT levels")
+{
+    GIVEN("A node with a backlog of 300 pubs and a peer that just joined")
+    {
+        Node a(io, keyChain);
+        advanceClocks(10_ms);
+        std::vector<Name> names;
+        for (int i = 0; i < 300; i++) {
+            auto pub = makePub(Name("/position").appendNumber(i));
+            names.push_back(pub.getName());
+            a.sync.publish(std::move(pub));
+            advanceClocks(1_ms);
+        }
+        Node b(io, keyChain);
+        a.face.linkTo(b.face);
+        // iblt sizes of b's sync interests from the 'from'th one on
+        auto sizesSent = [&b](size_t from = 0) {
+            std::vector<size_t> sizes;
+            const auto &sent = b.face.sentInterests;
+            for (size_t i = from; i < sent.size(); i++) {
+                if (Name("/sync").isPrefixOf(sent[i].getName()) && sent[i].getName().size() == 2) {
+                    IBLT iblt(0);
+                    iblt.decode(sent[i].getName()[-1]);
+                    sizes.push_back(iblt.size());
+                }
+            }
+            return sizes;
+        };
+        const auto smallest = IBLT(85).size();
+
+        THEN("The peer raises its level, gets them all, then steps back down") {
+            advanceClocks(100_ms, 100);
+            auto got = b.got;
+            std::sort(got.begin(), got.end());
+            std::sort(names.begin(), names.end());
+            REQUIRE(got == names);
+            const auto during = sizesSent();
+            REQUIRE(std::any_of(during.begin(), during.end(), [&](auto n) { return n > smallest; }));
+
+            // each level is held for ibltLevelHold interests
+            advanceClocks(1_s, 3 * ibltLevelHold);
+            const auto after = sizesSent(b.face.sentInterests.size() - 1);
+            REQUIRE(after == std::vector<size_t>{smallest});
+        }
+    }
+}
+
+TEST_CASE_METHOD(SyncFixture, "Publishing to waiting peers")
+{
+    GIVEN("A node coalescing its sync interests over 500ms with a peer's interest pending")
+    {
+        Node a(io, keyChain);
+        a.sync.setRateControl({500_ms});
+        advanceClocks(10_ms);
+        const auto interest = peerInterest();
+        a.face.receive(interest);
+        advanceClocks(10_ms);
+
+        THEN("A publish answers the peer at once, ahead of our own sync interest") {
+            auto pub = makePub("/position/a");
+            const auto name = pub.getName();
+            a.sync.publish(std::move(pub));
+            advanceClocks(1_ms);
+            const auto replies = a.sentUnder(interest.getName());
+            REQUIRE(replies.size() == 1);
+            REQUIRE(parseReply(replies[0]).pubs == std::vector<Name>{name});
+            REQUIRE(a.sync.getStats().interestsSent == 1);
+        }
+    }
+
+    GIVEN("A node coalescing over 500ms that notifies recent peers, whose peer's interest expired")
+    {
+        Node a(io, keyChain);
+        a.sync.setRateControl({500_ms});
+        a.sync.setPeerPush(200_ms);
+        advanceClocks(10_ms);
+        const auto interest = peerInterest();
+        a.face.receive(interest);
+        advanceClocks(100_ms, 11);
+        const auto sent = a.sync.getStats().interestsSent;
+
+        THEN("A publish sends our sync interest at once, at most once per interval") {
+            a.sync.publish(makePub("/position/a"));
+            advanceClocks(1_ms);
+            REQUIRE(a.sync.getStats().interestsSent == sent + 1);
+            REQUIRE(a.sync.getStats().pushInterests == 1);
+            REQUIRE(a.sentUnder(interest.getName()).empty());
+            a.sync.publish(makePub("/position/b"));
+            advanceClocks(1_ms);
+            REQUIRE(a.sync.getStats().interestsSent == sent + 1);
+            REQUIRE(a.sync.getStats().pushInterests == 1);
+        }
+
+        THEN("Without notification the publish waits for the coalesce window") {
+            a.sync.setPeerPush(0_ms);
+            a.sync.publish(makePub("/position/a"));
+            advanceClocks(1_ms);
+            REQUIRE(a.sync.getStats().interestsSent == sent);
+            REQUIRE(a.sync.getStats().pushInterests == 0);
+        }
+
+        THEN("A peer isn't notified a lifetime past its interest's expiry") {
+            advanceClocks(100_ms, 10);
+            const auto later = a.sync.getStats().interestsSent;
+            a.sync.publish(makePub("/position/a"));
+            advanceClocks(1_ms);
+            REQUIRE(a.sync.getStats().interestsSent == later);
+            REQUIRE(a.sync.getStats().pushInterests == 0);
+        }
+    }
+}
+
+TEST_CASE_METHOD(SyncFixture, "Pulling pubs a peer has")
+{
+    GIVEN("Two unlinked nodes, one of which has just published")
+    {
+        Node a(io, keyChain);
+        Node b(io, keyChain);
+        advanceClocks(10_ms);
+        auto pub = makePub("/position/a");
+        const auto name = pub.getName();
+        a.sync.publish(std::move(pub));
+        advanceClocks(1_ms);
+        // a's sync interest now shows the pub
+        const auto aInterest = a.face.sentInterests.back();
+        const auto sent = b.sync.getStats().interestsSent;
+
+        THEN("The other pulls it as soon as it sees it in the first's interest") {
+            b.face.receive(aInterest);
+            advanceClocks(1_ms);
+            REQUIRE(b.sync.getStats().needInterests == 1);
+            REQUIRE(b.sync.getStats().interestsSent == sent + 1);
+            // a answers the pull long before b's periodic interest is due
+            a.face.receive(b.face.sentInterests.back());
+            advanceClocks(1_ms);
+            b.face.receive(a.face.sentData.back());
+            advanceClocks(1_ms);
+            REQUIRE(b.got == std::vector<Name>{name});
+        }
+
+        THEN("Pulls are at least needInterestInterval apart") {
+            b.face.receive(aInterest);
+            advanceClocks(1_ms);
+            b.face.receive(aInterest);
+            advanceClocks(needInterestInterval / 2);
+            b.face.receive(aInterest);
+            advanceClocks(1_ms);
+            REQUIRE(b.sync.getStats().needInterests == 1);
+            advanceClocks(needInterestInterval / 2);
+            b.face.receive(aInterest);
+            advanceClocks(1_ms);
+            REQUIRE(b.sync.getStats().needInterests == 2);
+            REQUIRE(b.sync.getStats().interestsSent == sent + 2);
+        }
+    }
+}
+
+TEST_CASE_METHOD(SyncFixture, "Reply suppression")
+{
+    GIVEN("A node holding its replies back up to 1s that has a peer's pub")
+    {
+        Node a(io, keyChain);
+        a.sync.setReplySuppression(1_s);
+        advanceClocks(10_ms);
+
+        const ndn::security::SigningInfo sha256(ndn::security::SigningInfo::SIGNER_TYPE_SHA256);
+        auto pub = makePub("/position/c");
+        keyChain.sign(pub, sha256);
+        // a signed sync reply named 'name' carrying 'pub' (and 'estimate')
+        auto reply = [&](const Name &name, uint64_t estimate = 0) {
+            ndn::Block content(syncps::tlv::syncpsContent);
+            if (estimate != 0) {
+                content.push_back(ndn::encoding::makeNonNegativeIntegerBlock(
+                        syncps::tlv::syncpsDiffEstimate, estimate));
+            }
+            content.push_back(pub.wireEncode());
+            content.encode();
+            ndn::Data data(name);
+            data.setContent(content);
+            keyChain.sign(data, sha256);
+            return data;
+        };
+        a.face.receive(reply(a.face.sentInterests.back().getName()));
+        advanceClocks(10_ms);
+        REQUIRE(a.got == std::vector<Name>{pub.getName()});
+
+        const auto interest = peerInterest();
+        a.face.receive(interest);
+        advanceClocks(1_us);
+        REQUIRE(a.sync.getStats().repliesDelayed == 1);
+        const auto listen = a.face.sentInterests.back();
+        REQUIRE(listen.getName() == interest.getName());
+        REQUIRE(listen.getHopLimit() == 1);
+
+        THEN("With nothing overheard the reply goes out") {
+            advanceClocks(100_ms, 11);
+            const auto replies = a.sentUnder(interest.getName());
+            REQUIRE(replies.size() == 1);
+            REQUIRE(parseReply(replies[0]).pubs == std::vector<Name>{pub.getName()});
+        }
+
+        THEN("Another node's reply with the same pub cancels it") {
+            a.face.receive(reply(interest.getName()));
+            advanceClocks(100_ms, 11);
+            REQUIRE(a.sentUnder(interest.getName()).empty());
+            REQUIRE(a.sync.getStats().repliesCancelled == 1);
+        }
+
+        THEN("The difference estimate in another node's reply is ignored") {
+            const auto sent = a.face.sentInterests.size();
+            a.face.receive(reply(interest.getName(), 1000));
+            advanceClocks(100_ms, 15);
+            size_t resent = 0;
+            for (size_t i = sent; i < a.face.sentInterests.size(); i++) {
+                IBLT iblt(0);
+                iblt.decode(a.face.sentInterests[i].getName()[-1]);
+                REQUIRE(iblt.size() == IBLT(85).size());
+                ++resent;
+            }
+            REQUIRE(resent > 0);
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <vector>
+
+#include "../src/timer-wheel.h"
+
+using Clock = std::chrono::steady_clock;
+using namespace std::chrono_literals;
+
+TEST_CASE("TimerWheel")
+{
+    GIVEN("A wheel of 8 slots of 10ms")
+    {
+        const Clock::time_point start{1s};
+        syncps::TimerWheel<int, Clock> wheel(10ms, 8, start);
+        std::vector<int> fired;
+        auto collect = [&fired](int i) { fired.push_back(i); };
+
+        THEN("Entries fire once the tick containing their time is over") {
+            wheel.add(start + 25ms, 1);
+            wheel.add(start + 45ms, 2);
+            REQUIRE(wheel.size() == 2);
+            REQUIRE(wheel.advance(start + 29ms, collect) == 0);
+            REQUIRE(wheel.advance(start + 30ms, collect) == 1);
+            REQUIRE(fired == std::vector<int>{1});
+            REQUIRE(wheel.advance(start + 50ms, collect) == 1);
+            REQUIRE(fired == std::vector<int>{1, 2});
+            REQUIRE(wheel.empty());
+        }
+
+        THEN("Times in the past fire on the next tick") {
+            wheel.add(start - 1s, 1);
+            REQUIRE(wheel.advance(start + 5ms, collect) == 0);
+            REQUIRE(wheel.advance(start + 10ms, collect) == 1);
+        }
+
+        THEN("Entries more than one turn out wait for their own turn") {
+            // they fire on ticks 4 and 20, which share a slot
+            wheel.add(start + 35ms, 1);
+            wheel.add(start + 195ms, 2);
+            REQUIRE(wheel.advance(start + 40ms, collect) == 1);
+            REQUIRE(wheel.advance(start + 120ms, collect) == 0);
+            REQUIRE(wheel.advance(start + 199ms, collect) == 0);
+            REQUIRE(wheel.advance(start + 200ms, collect) == 1);
+            REQUIRE(fired == std::vector<int>{1, 2});
+        }
+
+        THEN("Jumping several turns at once fires everything that's due") {
+            for (int i = 0; i < 40; i++) {
+                wheel.add(start + i * 7ms, i);
+            }
+            REQUIRE(wheel.advance(start + 140ms, collect) == 20);
+            REQUIRE(wheel.size() == 20);
+            REQUIRE(wheel.advance(start + 1s, collect) == 20);
+            REQUIRE(fired.size() == 40);
+        }
+
+        THEN("Entries fired can add new ones") {
+            wheel.add(start + 5ms, 1);
+            wheel.advance(start + 10ms, [&](int i) {
+                fired.push_back(i);
+                wheel.add(start + 15ms, i + 1);
+            });
+            REQUIRE(fired == std::vector<int>{1});
+            REQUIRE(wheel.size() == 1);
+            REQUIRE(wheel.advance(start + 20ms, collect) == 1);
+            REQUIRE(fired == std::vector<int>{1, 2});
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <cstdint>
+
+#include <ndn-cxx/util/time.hpp>
+
+#include "../src/token-bucket.h"
+
+// 'n' milliseconds in Clock's own duration
+template<typename Clock>
+static typename Clock::duration ms(int64_t n) {
+    using D = typename Clock::duration;
+    return D(typename D::rep(n * D::period::den / D::period::num / 1000));
+}
+
+// std::chrono and ndn-cxx's (boost::chrono) clocks
+TEMPLATE_TEST_CASE("TokenBucket", "", std::chrono::steady_clock, ndn::time::steady_clock)
+{
+    using Bucket = syncps::TokenBucket<TestType>;
+    const typename TestType::time_point t0(ms<TestType>(5000));
+
+    GIVEN("An unlimited bucket")
+    {
+        Bucket bucket;
+
+        THEN("Every send is allowed") {
+            bucket.consume(1e9, t0);
+            REQUIRE_FALSE(bucket.limited());
+            REQUIRE(bucket.ready(t0));
+            REQUIRE(bucket.wait(t0) == TestType::duration::zero());
+        }
+    }
+
+    GIVEN("A bucket of 1000 bytes/s and 1500 bytes deep")
+    {
+        Bucket bucket(1000, 1500);
+
+        THEN("A full bucket allows a burst of its depth") {
+            REQUIRE(bucket.ready(t0));
+            bucket.consume(1000, t0);
+            REQUIRE(bucket.ready(t0));
+            bucket.consume(500, t0);
+            REQUIRE_FALSE(bucket.ready(t0));
+            auto wait = bucket.wait(t0);
+            REQUIRE(wait > ms<TestType>(0));
+            REQUIRE(wait <= ms<TestType>(2));
+            REQUIRE(bucket.ready(t0 + wait));
+        }
+
+        THEN("A send larger than the depth goes out and is paid back") {
+            bucket.consume(3000, t0);
+            auto wait = bucket.wait(t0);
+            REQUIRE(wait >= ms<TestType>(1500));
+            REQUIRE(wait <= ms<TestType>(1502));
+            REQUIRE_FALSE(bucket.ready(t0 + ms<TestType>(1400)));
+            REQUIRE(bucket.ready(t0 + wait));
+        }
+
+        THEN("Idle time only fills the bucket to its depth") {
+            bucket.consume(1500, t0);
+            auto t = t0 + ms<TestType>(60000);
+            REQUIRE(bucket.ready(t));
+            bucket.consume(1500, t);
+            REQUIRE_FALSE(bucket.ready(t));
+        }
+
+        THEN("Sending whenever allowed keeps to the rate") {
+            double sent = 0;
+            for (auto t = t0; t < t0 + ms<TestType>(10000); t += ms<TestType>(1)) {
+                while (bucket.ready(t)) {
+                    bucket.consume(100, t);
+                    sent += 100;
+                }
+            }
+            REQUIRE(sent >= 10000);
+            REQUIRE(sent <= 10000 + 1500 + 100);
+        }
+    }
+}